@@ -1,6 +1,6 @@
 #define LOGGER
+//#define LOG_MIN_LEVEL LOG_LEVEL_INFO
 #define USE_DUMPER
-#define UART_PACKET_SIZE 16
 #define UART_PACKET_MIN_INTERVAL 16000
 
 #define SCHEDULER_SOURCE millis()
@@ -10,15 +10,23 @@
 #include "Joystick.h"
 
 #include "DataPacker2.h"
+#include "RobotProtocol.h"
 #include "AsyncUart.h"
+#if defined(UART_AEAD) || defined(UART_ARQ)
+#include "BootEntropy.h"
+#endif
+#include "E32Module.h"
+#include "RateNegotiator.h"
+#include "TxScheduler.h"
+#ifdef UART_TDMA
+#include "PollSchedule.h"
+#endif
 
 #include "Logger.h"
+#include "LogPipe.h"
 #include "Schedule.h"
 #include "watchdog_reset.h"
 
-constexpr uint8_t controller_id = 0x01;
-constexpr uint8_t robot_id = 0x02;
-
 /* Led patterns */
 uint32_t pled_disconnected[]{ 100, 400 };
 #define PLED_DISCONNECTED pled_disconnected, (sizeof(pled_disconnected) / sizeof(uint32_t)), false
@@ -28,8 +36,6 @@ uint32_t pled_system[]{ 10, 140 };
 uint32_t pled_error[]{ 50, 250, 50, 250, 50, 700 };
 #define PLED_ERROR pled_error, (sizeof(pled_error) / sizeof(uint32_t)), false
 
-uint8_t data_map[] = { 1, 1, 1, 1, 1, 1, 2, 2, 2 };
-
 /* Inputs and outputs */
 LedFlasher led_power(PB12, HIGH);
 LedFlasher led_ready(PB13, HIGH);
@@ -45,7 +51,28 @@ Joystick joystick(4095, 0.1f, PA5, PA1);
 Joystick max_v(4095, 0.0f, PA3, 255);
 
 UartData control_packet;
+ControlMessage command;
+// log lines wait here instead of blocking loop() on the USB serial
+LogPipe<1024> log_pipe;
+
+void logToPipe(const char * buffer, const uint8_t length) {
+    log_pipe.push(buffer, length);
+}
+
 AsyncUart lora(&Serial1, controller_id);
+// M0 on PB15, M1 on PA8, no AUX wired
+E32Module<HardwareSerial> radio(&Serial1, PB15, PA8, 57600);
+#ifdef E32_NEGOTIATE
+RateNegotiator air_rate(true, E32_BASE_RATE, E32_TARGET_RATE);
+#endif
+TxScheduler tx_scheduler;
+
+#ifdef UART_TDMA
+// robots polled in turn, every one flashed with its own ROBOT_ID
+constexpr uint8_t robot_ids[]{ robot_id };
+static_assert(sizeof(robot_ids) <= TDMA_ROBOTS, "more robots than TDMA_ROBOTS, the robots would time out between polls");
+PollSchedule<> poll;
+#endif
 
 uint32_t last_response_ms{ 0 };
 bool has_connection{ false };
@@ -63,15 +90,82 @@ RelayButtonAllowStatus relay_btn_allow_status { RelayButtonAllowStatus::UNKNOWN
 
 int16_t _x{ 0 }, _y{ 0 }, _max_v{ 0 };
 
+void configureRadio() {
+    radio.begin();
+    E32Config config;
+    if (!radio.readConfig(config)) {
+        ERROR("E32 module not answering");
+        return;
+    }
+    INFOF("E32 air %lu bps, uart %lu bps, fec %u, power %u",
+        (unsigned long)E32Config::airRateBps(config.airRate()), (unsigned long)E32Config::uartBps(config.uartBaud()),
+        config.fec(), config.txPower());
+#ifdef E32_NEGOTIATE
+    // a rate negotiated before a reset is still set until power-off, start from the base rate
+    if (config.airRate() != E32_BASE_RATE && !radio.setAirRate(E32_BASE_RATE))
+        ERROR("E32 base air rate not set");
+#endif
+}
+
+#ifdef E32_NEGOTIATE
+uint8_t switching_rate{ E32_BASE_RATE };
+
+/// start the change without blocking, pollAirRate() finishes it
+void switchAirRate(const uint8_t rate) {
+    // not saved: a power cycle brings back the flashed base rate
+    if (!radio.startAirRate(rate))
+        ERRORF("E32 air rate %lu bps not set, still switching", (unsigned long)E32Config::airRateBps(rate));
+    switching_rate = rate;
+}
+
+void pollAirRate() {
+    const auto job = radio.run();
+    if (job == decltype(radio)::Job::DONE)
+        INFOF("E32 air rate %lu bps", (unsigned long)E32Config::airRateBps(switching_rate));
+    else if (job == decltype(radio)::Job::FAILED)
+        ERRORF("E32 air rate %lu bps not set", (unsigned long)E32Config::airRateBps(switching_rate));
+    else
+        return;
+    lora.begin(57600);
+}
+#endif
+
+/// false while the module is in configuration mode, the link keeps off the port
+inline bool radioReady() {
+#ifdef E32_NEGOTIATE
+    return !radio.busy();
+#else
+    return true;
+#endif
+}
+
 void setup() {
     Serial.begin(115200);
     Serial.setTimeout(3);
+    logger.flushPipe = logToPipe;
+    configureRadio();
     lora.begin(57600);
-
-    pinMode(PB15, OUTPUT);
-    pinMode(PA8, OUTPUT);
-    digitalWrite(PB15, LOW);
-    digitalWrite(PA8, LOW);
+#ifdef UART_TDMA
+    for (const uint8_t id : robot_ids)
+        poll.add(id, AsyncUart::turnUs(ControlSchema::size, TelemetrySteps::size));
+    INFOF("polling %u robots, cycle %lu ms, link timeout %lu ms", poll.count(),
+        (unsigned long)(poll.cycleUs() / 1000), (unsigned long)AsyncUart::linkTimeoutMs());
+    // the robots would drop the link between two polls: send nothing, they stay stopped
+    if (poll.cycleUs() / 1000 >= AsyncUart::linkTimeoutMs()) {
+        ERROR("poll cycle reaches the link timeout, raise TDMA_ROBOTS or LINK_TIMEOUT_MS");
+        for (;;)
+            log_pipe.drain();
+    }
+#endif
+#if defined(UART_AEAD) || defined(UART_ARQ)
+    const uint32_t entropy = bootEntropy();
+#endif
+#ifdef UART_AEAD
+    lora.secure(entropy);
+#endif
+#ifdef UART_ARQ
+    lora.lane().seed(entropy);
+#endif
 
     sw_emergency.attach(PB1, true);
     sw_enable.attach(PB0, true);
@@ -144,9 +238,58 @@ void setup() {
     //iwdg_init(iwdg_prescaler::IWDG_PRE_256, 100);
 }
 
+/// one CSV line per telemetry page for the logging PC, "$TLM,<robot>,<page>,<state>,<page fields>"
+/// step counters are the low 24 bits, the PC side unwraps them
+void forwardTelemetry(const TelemetryMessage & t) {
+    char line[64];
+    int length = snprintf(line, sizeof(line), "$TLM,%u,%u,%u%u%u%u,",
+        t.from, (uint8_t)t.page, t.emergency, t.enable, t.relay_1, t.relay_2);
+
+    switch (t.page) {
+    case TelemetryPage::VELOCITY:
+        length += snprintf(line + length, sizeof(line) - length, "%d,%d", t.left_percent, t.right_percent);
+        break;
+    case TelemetryPage::STEPS:
+        length += snprintf(line + length, sizeof(line) - length, "%ld,%ld", (long)t.left_steps, (long)t.right_steps);
+        break;
+    case TelemetryPage::HEALTH:
+        length += snprintf(line + length, sizeof(line) - length, "%u,%u,%u", t.loop_max_us, t.isr_load_percent, t.supply_mv);
+        break;
+    case TelemetryPage::LINK:
+        length += snprintf(line + length, sizeof(line) - length, "%u,%u,%u,%u", t.loss_percent, t.error_percent, t.rtt_ms, t.jitter_ms);
+        break;
+    }
+    // through the pipe like log lines, so neither lands in the middle of the other
+    if (length > int(sizeof(line)) - 3)
+        length = sizeof(line) - 3;
+    line[length++] = '\r';
+    line[length++] = '\n';
+    log_pipe.push(line, length);
+}
+
+/// a reply from a Receiver, called from lora.dispatch()
+void onTelemetry(const TelemetryMessage & telemetry) {
+#ifdef UART_TDMA
+    poll.replied(telemetry.from);
+#endif
+    forwardTelemetry(telemetry);
+    last_response_ms = millis();
+#ifdef E32_NEGOTIATE
+    air_rate.onLink(last_response_ms);
+#endif
+}
+
+typedef MessageTable<TelemetryHandler<onTelemetry>> ControllerMessages;
+
 void loop() {
     //iwdg_feed();
-    lora.update();
+#ifdef E32_NEGOTIATE
+    pollAirRate();
+#endif
+    if (radioReady())
+        lora.update();
+    LOG_DRAIN();
+    log_pipe.drain();
 
     // update states
     led_power.update();
@@ -200,7 +343,7 @@ void loop() {
     }
 
     if (millis() > 2000UL
-        && millis() < last_response_ms + 2000UL) {
+        && millis() < last_response_ms + AsyncUart::linkTimeoutMs()) {
         if (!has_connection) {
             INFO("RECEIVER CONNECTED");
             led_connection.on();
@@ -222,6 +365,36 @@ void loop() {
          _x, _y, _max_v);
      } 
 
+#ifdef UART_LINK_STATS
+    DO_EVERY(2000) {
+#ifdef UART_TDMA
+        for (const uint8_t id : robot_ids)
+            lora.logQuality(id);
+#else
+        lora.logQuality(robot_id);
+#endif
+    }
+#endif
+
+#ifdef E32_NEGOTIATE
+    {
+        // propose the faster rate, switch once the Receiver acknowledged it
+        static uint16_t failed_before = 0;
+        uint8_t rate;
+        if (has_connection && air_rate.proposal(millis(), rate)) {
+            const uint8_t message[]{ uint8_t(LinkCommand::AIR_RATE), rate };
+            failed_before = lora.lane().failed();
+            lora.sendReliable(robot_id, message, sizeof(message));
+        }
+        else if (air_rate.state() == RateNegotiator::State::PROPOSED
+            && lora.lane().pending() == 0 && lora.lane().failed() == failed_before) {
+            air_rate.onAcked(millis());
+        }
+        if (air_rate.update(millis(), rate))
+            switchAirRate(rate);
+    }
+#endif
+
     auto _enabled = sw_enable.isTriggered();
     auto _relay_1 = sw_relay_1.isTriggered();
     auto _relay_2 = sw_relay_2.isTriggered();
@@ -243,24 +416,35 @@ void loop() {
       _relay_2 = false;
     }
 
+    command.emergency = _emergency;
+    command.enable = _enabled;
+    command.relay_1 = _relay_1;
+    command.relay_2 = _relay_2;
+    command.joystick_x = _x;
+    command.joystick_y = _y;
+    command.max_v_percent = _max_v;
+
     control_packet.clear();
-    control_packet.push(controller_id);
-    control_packet.push(robot_id);
-    control_packet.push(_emergency);
-    control_packet.push(_enabled);
-    control_packet.push(_relay_1);
-    control_packet.push(_relay_2);
-    control_packet.push(_x);
-    control_packet.push(_y);
-    control_packet.push(_max_v);
-
-    DO_EVERY(100) {
-        lora.write(control_packet);
-        if (lora.available()) {
-            control_packet = lora.read();
-            control_packet.setSizeMap(data_map, sizeof(data_map));
-            //INFOF("message from %d", control_packet.get<uint8_t>(0));
-            last_response_ms = millis();
-        }
+    ControlSchema::encode(command, control_packet);
+
+#ifdef UART_TDMA
+    // every robot gets the command in its own slot, the poll is its heartbeat,
+    // a refused write() leaves the slot unstarted and the same robot due
+    const auto * slot = radioReady() && lora.clearToSend() ? poll.due(micros()) : nullptr;
+    if (slot != nullptr) {
+        command.to = slot->address;
+        control_packet.clear();
+        ControlSchema::encode(command, control_packet);
+        if (lora.write(control_packet, slot->length_us))
+            poll.polled(micros());
     }
+#else
+    // the scheduler commits only what the radio took: a write() refused because the
+    // Receiver's reply turn is still open, or TX is busy, leaves the command due
+    if (radioReady() && lora.clearToSend() && tx_scheduler.due(command, millis()) && lora.write(control_packet))
+        tx_scheduler.sent(command, millis());
+#endif
+
+    // every reply carries a telemetry page, see onTelemetry()
+    lora.dispatch<ControllerMessages>();
 }
@@ -0,0 +1,101 @@
+#pragma once
+
+/*
+* ---TxScheduler---
+* Decides when the Controller sends its control packet, instead of a fixed rate:
+*    - safety edge (emergency / enable / relays changed): send now, ignoring the
+*      rate cap, then repeat TX_BURST_COUNT - 1 times in case one is lost
+*    - stick moved more than TX_DEADBAND (or came back to exactly 0): send as
+*      soon as TX_MIN_INTERVAL_MS has passed since the previous packet
+*    - nothing changed: heartbeat every TX_HEARTBEAT_MS, keeps the link alive
+*      (the Receiver drops the connection after 2 s of silence)
+*
+*    if (scheduler.due(command, millis()) && lora.write(control_packet))
+*        scheduler.sent(command, millis());
+*
+* Only a packet the radio took counts: a refused write() (not our turn, TX busy)
+* leaves the scheduler as it was, so the same command is due again next loop.
+* ------------------
+*/
+
+#include <stdint.h>
+#include "RobotProtocol.h"
+
+// rate cap, keep above the time on air of one packet (see Airtime.h)
+#ifndef TX_MIN_INTERVAL_MS
+#define TX_MIN_INTERVAL_MS 50
+#endif
+
+#ifndef TX_HEARTBEAT_MS
+#define TX_HEARTBEAT_MS 250
+#endif
+
+// joystick / max velocity change (in %) that counts as a new command
+#ifndef TX_DEADBAND
+#define TX_DEADBAND 3
+#endif
+
+#ifndef TX_BURST_COUNT
+#define TX_BURST_COUNT 3
+#endif
+
+class TxScheduler {
+public:
+    /// true if 'message' should be sent now, nothing changes until sent()
+    bool due(const ControlMessage & message, const uint32_t now_ms) const {
+        const uint32_t elapsed = now_ms - m_last_tx_ms;
+
+        if (m_first || safetyChanged(message))
+            return true;
+
+        if (elapsed < TX_MIN_INTERVAL_MS)
+            return false;
+
+        if (m_burst_left > 0)
+            return true;
+
+        if (axisChanged(message.joystick_x, m_last.joystick_x)
+            || axisChanged(message.joystick_y, m_last.joystick_y)
+            || axisChanged(message.max_v_percent, m_last.max_v_percent))
+            return true;
+
+        return elapsed >= TX_HEARTBEAT_MS;
+    }
+
+    /// 'message' is on its way, later changes are measured against it
+    void sent(const ControlMessage & message, const uint32_t now_ms) {
+        if (m_first || safetyChanged(message))
+            m_burst_left = TX_BURST_COUNT - 1;
+        else if (m_burst_left > 0)
+            m_burst_left--;
+        m_last = message;
+        m_last_tx_ms = now_ms;
+        m_first = false;
+        m_sent++;
+    }
+
+    inline uint32_t sentCount() const {
+        return m_sent;
+    }
+
+private:
+    bool safetyChanged(const ControlMessage & message) const {
+        return message.emergency != m_last.emergency
+            || message.enable != m_last.enable
+            || message.relay_1 != m_last.relay_1
+            || message.relay_2 != m_last.relay_2;
+    }
+
+    static bool axisChanged(const int16_t value, const int16_t last) {
+        // releasing the stick must stop the robot exactly
+        if (value == 0)
+            return last != 0;
+        return abs(value - last) > TX_DEADBAND;
+    }
+
+    ControlMessage m_last;
+    uint32_t m_last_tx_ms{ 0 };
+    uint32_t m_sent{ 0 };
+    uint8_t m_burst_left{ 0 };
+    bool m_first{ true };
+};
@@ -15,22 +15,35 @@ constexpr bool INVERT_RIGHT_DIR = false;
 #include "Button.h"
 
 #define LOGGER
+//#define LOG_MIN_LEVEL LOG_LEVEL_INFO
 #define USE_DUMPER
-#define UART_PACKET_SIZE 16
 #define UART_PACKET_MIN_INTERVAL 16000
 #include "DataPacker2.h"
+#include "RobotProtocol.h"
 #include "AsyncUart.h"
+#if defined(UART_AEAD) || defined(UART_ARQ)
+#include "BootEntropy.h"
+#endif
+#include "E32Module.h"
+#include "RateNegotiator.h"
 
 #include "Logger.h"
+#include "LogPipe.h"
 #include "Schedule.h"
 #include "watchdog_reset.h"
+#include "cycle_counter.h"
 
 #include "SingleStepper.h"
+#include "SetpointBuffer.h"
 
-#define SCHEDULER_SOURCE millis()
+// last log lines and robot state survive a watchdog reset, reported on the next boot,
+// needs RobotLink's extras/noinit.ld in the link (the sketch does not link without it)
+//#define BLACK_BOX
+#ifdef BLACK_BOX
+#include "BlackBox.h"
+#endif
 
-constexpr uint8_t controller_id{ 0x01 };
-constexpr uint8_t robot_id{ 0x02 };
+#define SCHEDULER_SOURCE millis()
 
 constexpr uint8_t PIN_RELAY_MOTOR_POWER{ PB0 };
 constexpr uint8_t PIN_RELAY_RED_LIGHT{ PA7 };
@@ -42,6 +55,16 @@ constexpr uint8_t PIN_LMOTOR_DIR{ PA3 };
 constexpr uint8_t PIN_RMOTOR_PUL{ PA2 };
 constexpr uint8_t PIN_RMOTOR_DIR{ PA1 };
 
+// supply voltage on the health telemetry page, needs a divider the stock board does not have:
+//   supply + ---[22k]---+---[10k]--- GND
+//                       |
+//                      PB1          (3.3 V at PB1 for a 10.5 V supply)
+// without it the page reports 0 mV
+//#define SUPPLY_SENSE
+#ifdef SUPPLY_SENSE
+constexpr uint8_t PIN_SUPPLY_SENSE{ PB1 };
+#endif
+
 /* Led patterns */
 uint32_t pled_disconnected[]{ 100, 400 };
 #define PLED_DISCONNECTED pled_disconnected, (sizeof(pled_disconnected) / sizeof(uint32_t)), false
@@ -56,9 +79,44 @@ enum class ControlStyle {
 
 ControlStyle control_style{ ControlStyle::NONE };
 
-UartData control_packet;
-uint8_t data_map[] = { 1, 1, 1, 1, 1, 1, 2, 2, 2 };
+ControlMessage command;
+// log lines wait here instead of blocking loop() on the USB serial
+LogPipe<1024> log_pipe;
+
+#ifdef BLACK_BOX
+/// what the black box keeps of the robot, saved every 10 ms
+struct RobotState {
+    uint32_t loop_us;           // micros() when saved
+    uint32_t loop_max_us;       // longest loop() since the previous health page
+    uint32_t last_response_ms;  // last command from the Controller
+    int32_t left_step;
+    int32_t right_step;
+    float left_velocity;        // setpoints being played out, steps/s
+    float right_velocity;
+    uint16_t rtt_ms;            // link stats as last sent in telemetry
+    uint8_t loss_percent;
+    uint8_t error_percent;
+    bool emergency;
+    bool enable;
+    bool connected;
+};
+
+BlackBox<RobotState> black_box BLACKBOX_NOINIT;
+#endif
+
+void logToPipe(const char * buffer, const uint8_t length) {
+    log_pipe.push(buffer, length);
+#ifdef BLACK_BOX
+    black_box.log(buffer, length);
+#endif
+}
+
 AsyncUart lora(&Serial1, robot_id);
+// M0 on PB15, M1 on PA8, no AUX wired
+E32Module<HardwareSerial> radio(&Serial1, PB15, PA8, 57600);
+#ifdef E32_NEGOTIATE
+RateNegotiator air_rate(false, E32_BASE_RATE, E32_TARGET_RATE);
+#endif
 
 bool sw_emergency{ true };
 bool sw_enable{ false };
@@ -76,6 +134,26 @@ uint32_t m_last_response{ 0 };
 float max_velocity{ 0.0f };
 float left_velocity{ 0.0f };
 float right_velocity{ 0.0f };
+// latest commanded velocities, played out smoothly through setpoints
+float target_left_velocity{ 0.0f };
+float target_right_velocity{ 0.0f };
+SetpointBuffer<> setpoints;
+
+TelemetryMessage telemetry;
+uint8_t telemetry_index{ 0 };
+uint32_t loop_max_us{ 0 };
+// CPU cycles spent in stepper ISRs since the previous health page
+volatile uint32_t isr_busy_cycles{ 0 };
+uint32_t isr_window_start_us{ 0 };
+// no health page for this long: start a new window before the cycle count can wrap
+constexpr uint32_t ISR_WINDOW_MAX_US{ 30000000UL };
+// health page being sent: window end and busy cycles it reports
+uint32_t health_us{ 0 };
+uint32_t health_busy_cycles{ 0 };
+uint16_t telemetry_refused{ 0 };
+#ifdef SUPPLY_SENSE
+float supply_voltage{ 0.0f };
+#endif
 
 //SingleStepper stepper_left( PIN_LMOTOR_PUL, PIN_LMOTOR_DIR, &Timer3 );
 //SingleStepper stepper_right( PIN_RMOTOR_PUL, PIN_RMOTOR_DIR, &Timer4 );
@@ -87,31 +165,143 @@ float map_float(float x, float  in_min, float in_max, float out_min, float out_m
     return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
 }
 
+void configureRadio() {
+    radio.begin();
+    E32Config config;
+    if (!radio.readConfig(config)) {
+        ERROR("E32 module not answering");
+        return;
+    }
+    INFOF("E32 air %lu bps, uart %lu bps, fec %u, power %u",
+        (unsigned long)E32Config::airRateBps(config.airRate()), (unsigned long)E32Config::uartBps(config.uartBaud()),
+        config.fec(), config.txPower());
+#ifdef E32_NEGOTIATE
+    // a rate negotiated before a reset is still set until power-off, start from the base rate
+    if (config.airRate() != E32_BASE_RATE && !radio.setAirRate(E32_BASE_RATE))
+        ERROR("E32 base air rate not set");
+#endif
+}
+
+#ifdef BLACK_BOX
+/// why the previous run ended and what it was doing, then start recording this one
+void reportReset() {
+    black_box.begin();
+    if (!black_box.placed())
+        ERROR("black box not in .noinit, nothing survives a reset");
+    INFOF("reset: %s (RCC_CSR %08lx), %u warm resets since power-on",
+        black_box.resetCause(), (unsigned long)black_box.resetFlags(), black_box.resets());
+
+    RobotState state;
+    uint32_t state_ms;
+    if (black_box.recovered() && black_box.state(state, state_ms)) {
+        INFOF("at %lu ms: loop %lu us (max %lu), last command %lu ms",
+            (unsigned long)state_ms, (unsigned long)state.loop_us, (unsigned long)state.loop_max_us,
+            (unsigned long)state.last_response_ms);
+        INFOF("v %ld/%ld steps %ld/%ld, em %d en %d conn %d, loss %u%% err %u%% rtt %u ms",
+            (long)state.left_velocity, (long)state.right_velocity, (long)state.left_step, (long)state.right_step,
+            state.emergency, state.enable, state.connected, state.loss_percent, state.error_percent, state.rtt_ms);
+    }
+    if (black_box.recovered()) {
+        // straight to the pipe, logging them would write them back into the box
+        const uint8_t lines = black_box.replay([](const char * buffer, const uint8_t length) {
+            log_pipe.push(buffer, length);
+        });
+        INFOF("%u lines recovered from before the reset", lines);
+    }
+    black_box.start();
+}
+
+void saveState() {
+    RobotState state;
+    state.loop_us = micros();
+    state.loop_max_us = loop_max_us;
+    state.last_response_ms = last_response_ms;
+    state.left_step = stepper_left.current_step;
+    state.right_step = stepper_right.current_step;
+    state.left_velocity = left_velocity;
+    state.right_velocity = right_velocity;
+    state.rtt_ms = telemetry.rtt_ms;
+    state.loss_percent = telemetry.loss_percent;
+    state.error_percent = telemetry.error_percent;
+    state.emergency = sw_emergency;
+    state.enable = sw_enable;
+    state.connected = has_connection;
+    black_box.snapshot(state, millis());
+}
+#endif
+
+#ifdef E32_NEGOTIATE
+uint8_t switching_rate{ E32_BASE_RATE };
+
+/// start the change without blocking, pollAirRate() finishes it
+void switchAirRate(const uint8_t rate) {
+    // not saved: a power cycle brings back the flashed base rate
+    if (!radio.startAirRate(rate))
+        ERRORF("E32 air rate %lu bps not set, still switching", (unsigned long)E32Config::airRateBps(rate));
+    switching_rate = rate;
+}
+
+void pollAirRate() {
+    const auto job = radio.run();
+    if (job == decltype(radio)::Job::DONE)
+        INFOF("E32 air rate %lu bps", (unsigned long)E32Config::airRateBps(switching_rate));
+    else if (job == decltype(radio)::Job::FAILED)
+        ERRORF("E32 air rate %lu bps not set", (unsigned long)E32Config::airRateBps(switching_rate));
+    else
+        return;
+    lora.begin(57600);
+}
+#endif
+
+/// false while the module is in configuration mode, the link keeps off the port
+inline bool radioReady() {
+#ifdef E32_NEGOTIATE
+    return !radio.busy();
+#else
+    return true;
+#endif
+}
+
 void setup() {
     Serial.begin(115200);
     Serial.setTimeout(3);
+    logger.flushPipe = logToPipe;
+#ifdef BLACK_BOX
+    reportReset();
+#endif
+    configureRadio();
     lora.begin(57600);
-
-    // LORA MD0-1
-    pinMode(PB15, OUTPUT);
-    pinMode(PA8, OUTPUT);
-    digitalWrite(PB15, LOW);
-    digitalWrite(PA8, LOW);
+#if defined(UART_AEAD) || defined(UART_ARQ)
+    const uint32_t entropy = bootEntropy();
+#endif
+#ifdef UART_AEAD
+    lora.secure(entropy);
+#endif
+#ifdef UART_ARQ
+    lora.lane().seed(entropy);
+#endif
 
     pinMode(PIN_RELAY_MOTOR_POWER, OUTPUT);
     pinMode(PIN_RELAY_RED_LIGHT, OUTPUT);
     pinMode(PIN_RELAY_1, OUTPUT);
     pinMode(PIN_RELAY_2, OUTPUT);
     pinMode(PIN_MOTOR_ENABLE, OUTPUT);
+#ifdef SUPPLY_SENSE
+    pinMode(PIN_SUPPLY_SENSE, INPUT_ANALOG);
+#endif
 
     led_system.setLoop(true);
     led_system.setRunning(true);
     led_system.setPattern(PLED_SYSTEM);
 
+    cycle_counter_init();
+
 #define motor_init_isr(motor) \
 		motor.timer_on->pause();\
 		motor.timer_on->attachInterrupt(0, []() {\
+			const uint32_t start = DWT->CYCCNT;\
 			motor.isr_on();\
+			isr_busy_cycles += DWT->CYCCNT - start;\
 		});\
 
     motor_init_isr(stepper_left);
@@ -122,9 +312,11 @@ void setup() {
     Timer2.pause();
     Timer2.setPeriod(20);
     Timer2.attachInterrupt(0, []() {
+        const uint32_t start = DWT->CYCCNT;
         const uint32_t current_us = micros();
         stepper_left.isr_off(current_us);
         stepper_right.isr_off(current_us);
+        isr_busy_cycles += DWT->CYCCNT - start;
     });
     Timer2.resume();
     Timer2.refresh();
@@ -136,12 +328,185 @@ void setup() {
     iwdg_init(iwdg_prescaler::IWDG_PRE_256, 100);
 }
 
+/// reply to a command with the next telemetry page in telemetry_rotation,
+/// a page the radio refused is sent again with the next reply
+void sendTelemetry() {
+    telemetry.page = telemetry_rotation[telemetry_index];
+
+    telemetry.emergency = sw_emergency;
+    telemetry.enable = sw_enable;
+    telemetry.relay_1 = sw_relay_1;
+    telemetry.relay_2 = sw_relay_2;
+
+    switch (telemetry.page) {
+    case TelemetryPage::VELOCITY:
+        telemetry.left_percent = stepper_left.current_velocity * 100.0f / MAX_V;
+        telemetry.right_percent = stepper_right.current_velocity * 100.0f / MAX_V;
+        break;
+    case TelemetryPage::STEPS:
+        telemetry.left_steps = stepper_left.current_step;
+        telemetry.right_steps = stepper_right.current_step;
+        break;
+    case TelemetryPage::HEALTH: {
+        health_us = micros();
+        noInterrupts();
+        health_busy_cycles = isr_busy_cycles;
+        interrupts();
+        // 64 bits: 100x the busy cycles overflows 32 bits after 0.6 s of ISR time
+        const uint64_t window_cycles = uint64_t(health_us - isr_window_start_us) * CYCLES_PER_MICROSECOND;
+        const uint64_t load_percent = window_cycles > 0 ? uint64_t(health_busy_cycles) * 100 / window_cycles : 0;
+
+        telemetry.isr_load_percent = min(load_percent, uint64_t(100));
+        telemetry.loop_max_us = min(loop_max_us, 0xFFFFUL);
+#ifdef SUPPLY_SENSE
+        telemetry.supply_mv = supply_voltage * 1000.0f;
+#else
+        telemetry.supply_mv = 0;
+#endif
+        break;
+    }
+    case TelemetryPage::LINK: {
+#ifdef UART_LINK_STATS
+        const LinkQuality q = lora.quality(controller_id);
+        telemetry.loss_percent = q.loss_percent;
+        telemetry.error_percent = q.error_percent;
+        telemetry.rtt_ms = min(q.rtt_ms, (uint16_t)1023);
+        telemetry.jitter_ms = min(q.jitter_ms, (uint16_t)255);
+#endif
+        break;
+    }
+    }
+
+    UartData resp;
+    encodeTelemetry(telemetry, resp);
+    if (!lora.write(resp)) {
+        telemetry_refused++;
+        WARNF_EVERY(UART_ERROR_LOG_MS, "telemetry reply refused, %u so far", telemetry_refused);
+        return;
+    }
+
+    // the health window restarts only once its page is on the way
+    if (telemetry.page == TelemetryPage::HEALTH) {
+        noInterrupts();
+        isr_busy_cycles -= health_busy_cycles;
+        interrupts();
+        isr_window_start_us = health_us;
+        loop_max_us = 0;
+    }
+    telemetry_index = (telemetry_index + 1) % (sizeof(telemetry_rotation) / sizeof(telemetry_rotation[0]));
+}
+
+/// a command from the Controller, called from lora.dispatch() with the packet still queued
+void onControl(const ControlMessage & message) {
+    last_response_ms = millis();
+#ifdef E32_NEGOTIATE
+    air_rate.onLink(last_response_ms);
+#endif
+    //INFOF("message from %d", message.from);
+
+    command = message;
+    sw_emergency = command.emergency;
+    sw_enable = command.enable;
+    sw_relay_1 = command.relay_1;
+    sw_relay_2 = command.relay_2;
+    joystick_x = command.joystick_x;
+    joystick_y = command.joystick_y;
+    max_v_percent = command.max_v_percent;
+
+    max_velocity = float(max_v_percent) / 100.0f * MAX_V;
+    const auto px = float(joystick_x) / 100.0f;
+    const auto py = float(joystick_y) / 100.0f;
+
+    if (sw_emergency) {
+      max_velocity = 0;
+      setpoints.clear();
+      stepper_left.fast_stop();
+      stepper_right.fast_stop();
+    }
+    
+    // inplace rotate
+    if (joystick_y == 0) {
+        if (control_style == ControlStyle::NONE
+            || control_style == ControlStyle::ROTATE_ONLY) {
+            control_style = ControlStyle::ROTATE_ONLY;
+            
+            target_left_velocity = px * ROTATE_ONLY_V;
+            target_right_velocity = -px * ROTATE_ONLY_V;
+        }
+        else {
+            target_left_velocity = 0;
+            target_right_velocity = 0;
+        }
+    }
+    // move + rotate
+    else {
+        if (control_style == ControlStyle::NONE
+            || control_style == ControlStyle::MOVE_AND_ROTATE) {
+            control_style = ControlStyle::MOVE_AND_ROTATE;
+            // rotate left?
+            if (joystick_x < 0) {
+                target_right_velocity = py * max_velocity;
+                target_left_velocity = map_float(px, -1, 0, target_right_velocity * MIN_ROTATE_RATIO, target_right_velocity);
+            }
+            // rotate right
+            else {
+                target_left_velocity = py * max_velocity;
+                target_right_velocity = map_float(px, 1, 0, target_left_velocity * MIN_ROTATE_RATIO, target_left_velocity);
+            }
+        }
+    }
+    if (joystick_x == 0 && joystick_y == 0) {
+        target_left_velocity = 0;
+        target_right_velocity = 0;
+        control_style = ControlStyle::NONE;
+    }
+    //DEBUGF("left %ld right %ld", (long)left_velocity, (long)right_velocity);
+
+#ifdef UART_LINK_STATS
+    const uint32_t sent_ms = lora.peerTime();
+#else
+    const uint32_t sent_ms = last_response_ms;
+#endif
+    setpoints.push(sent_ms, target_left_velocity, target_right_velocity, millis());
+
+    sendTelemetry();
+
+    DO_EVERY(500) {
+        DEBUGF("Em:%d En:%d R1:%d R2:%d x%d y%d max %d",
+           sw_emergency,
+           sw_enable,
+           sw_relay_1,
+           sw_relay_2,
+           joystick_x, joystick_y, max_v_percent);
+    }
+}
+
+typedef MessageTable<
+    MessageHandler<MessageType::CONTROL, ControlSchema, ControlMessage, onControl>
+> ReceiverMessages;
+
 // #define TEST_COMMAND
 
 void loop() {
     const uint32_t current_us = micros();
+    static uint32_t last_loop_us = current_us;
+    if (current_us - last_loop_us > loop_max_us)
+        loop_max_us = current_us - last_loop_us;
+    last_loop_us = current_us;
+
     iwdg_feed();
-    lora.update();
+#ifdef BLACK_BOX
+    DO_EVERY(10) {
+        saveState();
+    }
+#endif
+#ifdef E32_NEGOTIATE
+    pollAirRate();
+#endif
+    if (radioReady())
+        lora.update();
+    LOG_DRAIN();
+    log_pipe.drain();
     led_system.update();
 
     stepper_left.update(current_us);
@@ -151,6 +516,9 @@ void loop() {
     stepper_right.isr_off(current_us);
 
 #ifndef TEST_COMMAND
+    DO_EVERY(1) {
+        setpoints.sample(millis(), left_velocity, right_velocity);
+    }
     stepper_left.set_peak_velocity(left_velocity);
     stepper_right.set_peak_velocity(right_velocity);
 #else
@@ -174,16 +542,33 @@ void loop() {
         }
     }
     DO_EVERY(1000) {
-        INFOF("v %5.0f  %ld/%ld %ld", stepper_left.current_velocity, stepper_left.current_step, stepper_left.temp_target_step, stepper_left.temp_target_step - stepper_left.current_step);
+        INFOF("v %5.0f  %ld/%ld %ld", stepper_left.current_velocity, (long)stepper_left.current_step, (long)stepper_left.temp_target_step,
+            (long)(stepper_left.temp_target_step - stepper_left.current_step));
         // enable?
         digitalWrite(PIN_MOTOR_ENABLE, HIGH);
     }
 
     return;
 #endif
+#ifdef SUPPLY_SENSE
+    DO_EVERY(150) {
+        const float vadc = float(analogRead(PIN_SUPPLY_SENSE)) * 3.3f / 4095.0f;
+        const float vsupply = vadc * (10.0f + 22.0f) / 10.0f;
+        supply_voltage = 0.8f * supply_voltage + 0.2f * vsupply;
+    }
+#endif
+
+    if (micros() - isr_window_start_us > ISR_WINDOW_MAX_US) {
+        noInterrupts();
+        isr_busy_cycles = 0;
+        interrupts();
+        isr_window_start_us = micros();
+        loop_max_us = 0;
+    }
+
     // check connection
     if (millis() > 2000UL
-        && millis() < last_response_ms + 2000UL) {
+        && millis() < last_response_ms + AsyncUart::linkTimeoutMs()) {
         if (!has_connection) {
             has_connection = true;
             INFO("CONTROLLER CONNECTED");
@@ -195,89 +580,45 @@ void loop() {
 
         //sw_emergency = true; // disable only, don't cut the power
         sw_enable = false;
+        setpoints.clear();
+        target_left_velocity = 0;
+        target_right_velocity = 0;
         left_velocity = 0;
         right_velocity = 0;
         // TODO: fast stop motors
     }
-    // read from buffer
-    if (lora.available()) {
-        last_response_ms = millis();
-        control_packet = lora.read();
-        control_packet.setSizeMap(data_map, sizeof(data_map));
-        //INFOF("message from %d", control_packet.get<uint8_t>(0));
-
-        uint8_t index = 2;
-        sw_emergency = control_packet.get<bool>(index++);
-        sw_enable = control_packet.get<bool>(index++);
-        sw_relay_1 = control_packet.get<bool>(index++);
-        sw_relay_2 = control_packet.get<bool>(index++);
-        joystick_x = control_packet.get<int16_t>(index++);
-        joystick_y = control_packet.get<int16_t>(index++);
-        max_v_percent = control_packet.get<int16_t>(index++);
-
-        max_velocity = float(max_v_percent) / 100.0f * MAX_V;
-        const auto px = float(joystick_x) / 100.0f;
-        const auto py = float(joystick_y) / 100.0f;
-
-        if (sw_emergency) {
-          max_velocity = 0;
-          stepper_left.fast_stop();
-          stepper_right.fast_stop();
-        }
-        
-        // inplace rotate
-        if (joystick_y == 0) {
-            if (control_style == ControlStyle::NONE
-                || control_style == ControlStyle::ROTATE_ONLY) {
-                control_style = ControlStyle::ROTATE_ONLY;
-                
-                left_velocity = px * ROTATE_ONLY_V;
-                right_velocity = -px * ROTATE_ONLY_V;
-            }
-            else {
-                left_velocity = 0;
-                right_velocity = 0;
-            }
-        }
-        // move + rotate
-        else {
-            if (control_style == ControlStyle::NONE
-                || control_style == ControlStyle::MOVE_AND_ROTATE) {
-                control_style = ControlStyle::MOVE_AND_ROTATE;
-                // rotate left?
-                if (joystick_x < 0) {
-                    right_velocity = py * max_velocity;
-                    left_velocity = map_float(px, -1, 0, right_velocity * MIN_ROTATE_RATIO, right_velocity);
-                }
-                // rotate right
-                else {
-                    left_velocity = py * max_velocity;
-                    right_velocity = map_float(px, 1, 0, left_velocity * MIN_ROTATE_RATIO, left_velocity);
-                }
-            }
-        }
-        if (joystick_x == 0 && joystick_y == 0) {
-            left_velocity = 0;
-            right_velocity = 0;
-            control_style = ControlStyle::NONE;
-        }
-        //DEBUGF("left %ld right %ld", (long)left_velocity, (long)right_velocity);
 
-        DO_EVERY(500) {
-            UartData resp;
-            resp.push(robot_id);
-            resp.push(controller_id);
+#ifdef UART_LINK_STATS
+    DO_EVERY(2000) {
+        lora.logQuality(controller_id);
+    }
+#endif
 
-            lora.write(resp);
+#ifdef UART_ARQ
+    // one-shot commands from the Controller
+    while (lora.lane().available()) {
+        const auto & message = lora.lane().peek();
+#ifdef E32_NEGOTIATE
+        if (message.length == 2 && message.data[0] == uint8_t(LinkCommand::AIR_RATE))
+            air_rate.onProposal(message.data[1], millis());
+        else
+#endif
+        INFOF("reliable message from %u, %u bytes", message.peer, message.length);
+        lora.lane().pop();
+    }
+#endif
 
-            DEBUGF("Em:%d En:%d R1:%d R2:%d x%d y%d max %d",
-               sw_emergency,
-               sw_enable,
-               sw_relay_1,
-               sw_relay_2,
-               joystick_x, joystick_y, max_v_percent);
-        }
+#ifdef E32_NEGOTIATE
+    {
+        uint8_t rate;
+        if (air_rate.update(millis(), rate))
+            switchAirRate(rate);
     }
+#endif
+
+    // decode and handle whatever came in, see onControl(), its reply needs the port
+    if (radioReady())
+        lora.dispatch<ReceiverMessages>();
 
     digitalWrite(PIN_RELAY_RED_LIGHT, (has_connection && sw_enable) ? HIGH : LOW);
 
@@ -0,0 +1,134 @@
+#pragma once
+
+/*
+* ---SetpointBuffer---
+* Playout buffer for wheel velocity setpoints.
+* Setpoints are stamped with the sender's clock and played out
+* SETPOINT_PLAYOUT_DELAY_MS after they could have arrived at the earliest,
+* so irregular radio delivery turns into evenly spaced, smooth commands:
+*
+*    time:  ---a-------b-----c--->        (sender clock)
+*    out:   a ramps to b, b ramps to c, then holds c until the next one.
+*           A late packet is never extrapolated: the output always stays
+*           between two commanded setpoints, it cannot overshoot, exceed
+*           what was commanded or reverse a wheel.
+*
+* The sender only transmits on change or as a slow heartbeat (TxScheduler),
+* so a ramp never starts earlier than SETPOINT_MAX_RAMP_MS before its target:
+* a long constant stretch followed by a change must not turn into a slow ramp.
+*
+* The clock offset is the smallest (local - sender) seen, allowed to creep
+* up by 1 ms per setpoint so it follows clock drift and route changes.
+* ------------------
+*/
+
+#include <stdint.h>
+
+#ifndef SETPOINT_PLAYOUT_DELAY_MS
+#define SETPOINT_PLAYOUT_DELAY_MS 60
+#endif
+
+#ifndef SETPOINT_MAX_RAMP_MS
+#define SETPOINT_MAX_RAMP_MS 100
+#endif
+
+template <uint8_t capacity = 8>
+class SetpointBuffer {
+public:
+    void clear() {
+        m_count = 0;
+        m_has_offset = false;
+    }
+
+    /// add a setpoint stamped 'sender_ms' by the sender, received at 'now_ms'
+    void push(const uint32_t sender_ms, const float left, const float right, const uint32_t now_ms) {
+        const int32_t offset = now_ms - sender_ms;
+        if (!m_has_offset || offset < m_offset)
+            m_offset = offset;
+        else
+            m_offset++;
+        m_has_offset = true;
+
+        // out of order or duplicate, already played past it
+        if (m_count > 0 && (int32_t)(sender_ms - newest().time) <= 0)
+            return;
+
+        if (m_count == capacity) {
+            m_head = (m_head + 1) % capacity;
+            m_count--;
+        }
+        Setpoint & s = m_points[(m_head + m_count) % capacity];
+        s.time = sender_ms;
+        s.left = left;
+        s.right = right;
+        m_count++;
+    }
+
+    /// setpoint for local time 'now_ms', false if nothing was pushed yet
+    bool sample(const uint32_t now_ms, float & left, float & right) {
+        if (m_count == 0)
+            return false;
+
+        // playout position on the sender's clock
+        const uint32_t t = now_ms - m_offset - SETPOINT_PLAYOUT_DELAY_MS;
+
+        // drop what the playout has moved past, the newest one is held
+        while (m_count > 2 && (int32_t)(t - at(1).time) >= 0) {
+            m_head = (m_head + 1) % capacity;
+            m_count--;
+        }
+
+        const Setpoint & a = at(0);
+        if (m_count == 1 || (int32_t)(t - a.time) <= 0) {
+            left = a.left;
+            right = a.right;
+            return true;
+        }
+
+        const Setpoint & b = at(1);
+        const uint32_t span = b.time - a.time;
+        const int32_t ramp = span < SETPOINT_MAX_RAMP_MS ? span : SETPOINT_MAX_RAMP_MS;
+        int32_t into_ramp = (int32_t)(t - (b.time - ramp));
+        // past b: the next one is late, hold b
+        if (into_ramp > ramp)
+            into_ramp = ramp;
+
+        if (into_ramp <= 0) {
+            left = a.left;
+            right = a.right;
+        }
+        else {
+            const float k = float(into_ramp) / float(ramp);
+            left = blend(a.left, b.left, k);
+            right = blend(a.right, b.right, k);
+        }
+        return true;
+    }
+
+private:
+    struct Setpoint {
+        uint32_t time;
+        float left;
+        float right;
+    };
+
+    inline const Setpoint & at(const uint8_t i) const {
+        return m_points[(m_head + i) % capacity];
+    }
+
+    inline const Setpoint & newest() const {
+        return at(m_count - 1);
+    }
+
+    /// a -> b for k in [0, 1], exactly b at 1
+    static float blend(const float a, const float b, const float k) {
+        return k >= 1.0f ? b : a + (b - a) * k;
+    }
+
+    Setpoint m_points[capacity];
+    uint8_t m_head{ 0 };
+    uint8_t m_count{ 0 };
+
+    int32_t m_offset{ 0 };
+    bool m_has_offset{ false };
+};
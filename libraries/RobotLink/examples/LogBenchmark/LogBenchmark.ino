@@ -0,0 +1,62 @@
+/*
+* Cycles per log call, text Logger vs LOG_DEFERRED records,
+* measured with the Cortex-M3 cycle counter, results go out as text on Serial.
+* Output of the calls is thrown away, only the call itself is measured
+* (plus LOG_DRAIN() on its own for the deferred side).
+*/
+
+#define LOGGER
+#define LOG_DEFERRED
+#include "Logger.h"
+
+#define DEMCR       (*(volatile uint32_t *)0xE000EDFC)
+#define DWT_CTRL    (*(volatile uint32_t *)0xE0001000)
+#define DWT_CYCCNT  (*(volatile uint32_t *)0xE0001004)
+
+constexpr uint16_t ROUNDS = 200;
+
+void discard(const char *, const uint8_t) {
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(3000);
+
+    DEMCR |= 1UL << 24;     // TRCENA
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= 1;          // CYCCNTENA
+
+    logger.flushPipe = discard;
+    uint16_t received = 120;
+    int16_t rtt = 35;
+
+    // what INFOF() expands to without LOG_DEFERRED
+    uint32_t start = DWT_CYCCNT;
+    for (uint16_t i = 0; i < ROUNDS; ++i)
+        logger.info().printf(F("link rx %u lost %u%% rtt %d ms"), received, i, rtt).end();
+    const uint32_t text_cycles = (DWT_CYCCNT - start) / ROUNDS;
+
+    uint32_t record_cycles = 0;
+    uint32_t drain_cycles = 0;
+    for (uint16_t i = 0; i < ROUNDS; ++i) {
+        start = DWT_CYCCNT;
+        INFOF("link rx %u lost %u%% rtt %d ms", received, i, rtt);
+        record_cycles += DWT_CYCCNT - start;
+
+        start = DWT_CYCCNT;
+        LOG_DRAIN();
+        drain_cycles += DWT_CYCCNT - start;
+    }
+    logger.flushPipe = nullptr;
+
+    Serial.print("text: ");
+    Serial.print(text_cycles);
+    Serial.print(" cycles, deferred: ");
+    Serial.print(record_cycles / ROUNDS);
+    Serial.print(" cycles + drain ");
+    Serial.print(drain_cycles / ROUNDS);
+    Serial.println(" cycles per call");
+}
+
+void loop() {
+}
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""
+Decode LOG_DEFERRED binary log records (see src/DeferredLog.h) back into text.
+
+The format strings are not sent by the firmware, they are read from the
+"logfmt" section of the ELF file that was flashed:
+
+    python3 logdecode.py Receiver.ino.elf < /dev/ttyACM0
+    python3 logdecode.py Receiver.ino.elf capture.bin
+
+Anything outside a record (DUMP() output, boot messages) is passed through.
+"""
+
+import re
+import struct
+import sys
+
+SYNC = 0xA5
+DROPPED_ID = 0xFFFF
+HEADER = struct.Struct("<BHI")  # level, format id, millis
+LEVELS = "VDIWE"
+
+# printf conversion: flags, width, precision, length, conversion
+SPEC = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t)?([diouxXcsfFeEgGp%])")
+
+
+def read_section(elf_path, name):
+    """contents of section 'name', minimal ELF32 / ELF64 little endian reader"""
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF" or elf[5] != 1:
+        raise ValueError("not a little endian ELF file")
+    if elf[4] == 1:
+        shoff, = struct.unpack_from("<I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+        section = struct.Struct("<IIIIIIIIII")
+    else:
+        shoff, = struct.unpack_from("<Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x3A)
+        section = struct.Struct("<IIQQQQIIQQ")
+
+    headers = [section.unpack_from(elf, shoff + i * shentsize) for i in range(shnum)]
+    names = headers[shstrndx]
+    for h in headers:
+        start = names[4] + h[0]
+        if elf[start:elf.index(b"\0", start)].decode() == name:
+            return elf[h[4]:h[4] + h[5]]
+    raise ValueError("no section %s, was the firmware built with LOG_DEFERRED?" % name)
+
+
+def format_string(strings, offset):
+    end = strings.index(b"\0", offset)
+    return strings[offset:end].decode(errors="replace")
+
+
+def render(fmt, args):
+    """printf 'fmt' with the raw argument bytes 'args'"""
+    out = []
+    position = 0
+    last = 0
+    for m in SPEC.finditer(fmt):
+        out.append(fmt[last:m.start()])
+        last = m.end()
+        flags, length, conversion = m.group(1), m.group(2), m.group(3)
+        if conversion == "%":
+            out.append("%")
+            continue
+        try:
+            if conversion == "s":
+                size = args[position]
+                value = args[position + 1:position + 1 + size].decode(errors="replace")
+                position += 1 + size
+            elif conversion in "fFeEgG":
+                value, = struct.unpack_from("<f", args, position)
+                position += 4
+            else:
+                wide = length == "ll"
+                signed = conversion in "di"
+                code = ("q" if signed else "Q") if wide else ("i" if signed else "I")
+                value, = struct.unpack_from("<" + code, args, position)
+                position += 8 if wide else 4
+                if conversion == "p":
+                    conversion, flags = "x", "#" + flags
+                elif conversion == "c":
+                    value = chr(value & 0xFF)
+                elif conversion == "u":
+                    conversion = "d"
+            out.append(("%" + flags + conversion) % value)
+        except (IndexError, struct.error):
+            out.append("<cut>")
+    out.append(fmt[last:])
+    return "".join(out)
+
+
+def timestamp(ms):
+    s = ms // 1000
+    return "[%02d:%02d:%02d.%02d]" % (s // 3600 % 24, s // 60 % 60, s % 60, ms % 1000 // 10)
+
+
+def decode(stream, strings, out):
+    buffer = bytearray()
+    text = bytearray()
+    # whatever has arrived, do not wait for a full chunk on a live port
+    read = getattr(stream, "read1", stream.read)
+    while True:
+        chunk = read(64)
+        if not chunk:
+            break
+        buffer += chunk
+        while buffer:
+            if buffer[0] != SYNC:
+                text.append(buffer.pop(0))
+                if text.endswith(b"\n"):
+                    out.write(text.decode(errors="replace"))
+                    text.clear()
+                continue
+            if len(buffer) < 2 or len(buffer) < 2 + buffer[1]:
+                break
+            record = bytes(buffer[2:2 + buffer[1]])
+            del buffer[:2 + len(record)]
+            if len(record) < HEADER.size:
+                continue
+            level, format_id, ms = HEADER.unpack_from(record)
+            args = record[HEADER.size:]
+            if format_id == DROPPED_ID:
+                line = "<%d records dropped>" % struct.unpack_from("<I", args)[0]
+            elif format_id < len(strings):
+                line = render(format_string(strings, format_id), args)
+            else:
+                line = "<unknown format %d>" % format_id
+            tag = LEVELS[level] if level < len(LEVELS) else "?"
+            out.write("%s -%s: %s\n" % (timestamp(ms), tag, line))
+            out.flush()
+    out.write(text.decode(errors="replace"))
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+    strings = read_section(sys.argv[1], "logfmt")
+    if len(sys.argv) > 2:
+        with open(sys.argv[2], "rb") as stream:
+            decode(stream, strings, sys.stdout)
+    else:
+        decode(sys.stdin.buffer, strings, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,108 @@
+#pragma once
+
+/*
+* ---Airtime---
+* Time on air estimates for the E32 (SX127x LoRa) link, to compare packet
+* layouts and pick packet rates.
+*
+* loraAirtimeUs() is the Semtech time-on-air formula (SX1276 datasheet 4.1.1.7):
+*    T_sym      = 2^SF / BW
+*    T_preamble = (n_preamble + 4.25) * T_sym
+*    n_payload  = 8 + max(ceil((8PL - 4SF + 28 + 16CRC - 20IH) / (4(SF - 2DE))) * (CR + 4), 0)
+*
+* uartAirtimeUs() is the simpler "bytes / data rate" view, good enough
+* to compare two layouts on the same module setting, and exact for the
+* UART between the MCU and the module.
+*
+* e32AirtimeUs() is loraAirtimeUs() with the LoRa setting behind an E32 air
+* data rate: at 2.4k a 10 byte packet is 124 ms on air, not the 33 ms the
+* data rate suggests (preamble, header and whole symbols).
+*
+*    uint32_t t = loraAirtimeUs(frameSize(ControlSchema::size), 12, 125000);
+*    uint32_t t = e32AirtimeUs(frameSize(ControlSchema::size), 2400);
+*
+* turnAirtimeUs() sizes a master / slave exchange (UART_HALF_DUPLEX, PollSchedule),
+* pollTimeoutMs() the silence a polled robot must tolerate.
+* ------------------
+*/
+
+#include <stdint.h>
+#include "FrameParser.h"
+
+/// bytes on air for a payload of 'payload' bytes, framed or as a raw fixed packet
+static inline uint8_t frameSize(const uint8_t payload, const bool framed = true) {
+	return framed ? payload + FRAME_OVERHEAD : payload;
+}
+
+/// LoRa time on air in microseconds
+/// sf: 6..12, bandwidth in Hz, coding_rate 1..4 (4/5..4/8)
+static inline uint32_t loraAirtimeUs(const uint8_t payload, const uint8_t sf, const uint32_t bandwidth,
+	const uint8_t coding_rate = 1, const uint16_t preamble = 8,
+	const bool explicit_header = true, const bool crc = true) {
+	const uint32_t symbol_us = (1000000UL << sf) / bandwidth;
+	// low data rate optimization is mandatory above 16ms per symbol
+	const int32_t de = symbol_us > 16000 ? 1 : 0;
+	const int32_t ih = explicit_header ? 0 : 1;
+
+	const int32_t numerator = 8 * (int32_t)payload - 4 * sf + 28 + (crc ? 16 : 0) - 20 * ih;
+	const int32_t denominator = 4 * (sf - 2 * de);
+	int32_t blocks = numerator > 0 ? (numerator + denominator - 1) / denominator : 0;
+
+	const uint32_t payload_symbols = 8 + blocks * (coding_rate + 4);
+	// (preamble + 4.25) symbols
+	const uint32_t preamble_us = preamble * symbol_us + (symbol_us * 17) / 4;
+	return preamble_us + payload_symbols * symbol_us;
+}
+
+/// time to push 'bytes' through a link of 'air_rate' bits per second, in microseconds
+static inline uint32_t uartAirtimeUs(const uint8_t bytes, const uint32_t air_rate) {
+	return (uint32_t)bytes * 8UL * 1000000UL / air_rate;
+}
+
+struct LoraSetting {
+	uint8_t sf;
+	uint32_t bandwidth;
+};
+
+/// LoRa modulation behind an E32 (SX1278) air data rate, coding rate 4/5.
+/// Ebyte does not document it, these are read back from the module's radio registers.
+static inline LoraSetting e32LoraSetting(const uint32_t air_rate) {
+	if (air_rate <= 300)
+		return { 12, 125000 };
+	if (air_rate <= 1200)
+		return { 11, 250000 };
+	if (air_rate <= 2400)
+		return { 11, 500000 };
+	if (air_rate <= 4800)
+		return { 8, 250000 };
+	if (air_rate <= 9600)
+		return { 8, 500000 };
+	return { 7, 500000 };
+}
+
+/// E32 time on air of 'bytes' sent in transparent mode at 'air_rate' bits per second
+static inline uint32_t e32AirtimeUs(const uint8_t bytes, const uint32_t air_rate) {
+	const LoraSetting setting = e32LoraSetting(air_rate);
+	return loraAirtimeUs(bytes, setting.sf, setting.bandwidth);
+}
+
+/// one packet from MCU to MCU: into the sending module over its UART, on air,
+/// out of the receiving module over its UART
+static inline uint32_t e32PacketUs(const uint8_t bytes, const uint32_t air_rate, const uint32_t serial_baud) {
+	// 8N1: 10 bits per byte on the UART
+	return 2 * uartAirtimeUs(bytes, serial_baud * 8 / 10) + e32AirtimeUs(bytes, air_rate);
+}
+
+/// one half-duplex turn: command packet, reply window, reply packet, radio latency both ways
+static inline uint32_t turnAirtimeUs(const uint8_t command_bytes, const uint8_t reply_bytes,
+	const uint32_t air_rate, const uint32_t serial_baud, const uint32_t reply_window_us, const uint32_t guard_us) {
+	return e32PacketUs(command_bytes, air_rate, serial_baud) + reply_window_us
+		+ e32PacketUs(reply_bytes, air_rate, serial_baud) + 2 * guard_us;
+}
+
+/// link timeout for 'robots' polled in slots of 'slot_us': two worst-case cycles,
+/// so one lost poll is no disconnect, never below 'timeout_ms'
+static inline uint32_t pollTimeoutMs(const uint8_t robots, const uint32_t slot_us, const uint32_t timeout_ms) {
+	const uint32_t cycles_ms = 2UL * robots * (slot_us / 1000 + 1);
+	return cycles_ms > timeout_ms ? cycles_ms : timeout_ms;
+}
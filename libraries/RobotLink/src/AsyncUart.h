@@ -0,0 +1,909 @@
+#pragma once
+
+#include "Arduino.h"
+#include <libmaple/usart.h>
+#include <HardwareSerial.h>
+#include "DataPacker2.h"
+#include "RobotProtocol.h"
+#include "Schedule.h"
+
+#if defined(UART_RX_DMA) || defined(UART_TX_DMA)
+#include <libmaple/dma.h>
+#endif
+
+#ifdef UART_RX_DMA
+#include "DmaRxRing.h"
+#endif
+
+#include "FrameParser.h"
+
+#ifdef UART_AEAD
+#include "LinkCipher.h"
+#endif
+
+#ifdef UART_LINK_STATS
+#include "LinkStats.h"
+#endif
+
+#include "Airtime.h"
+
+#ifdef UART_ARQ
+#include "ReliableLane.h"
+#endif
+
+#ifdef UART_FEC
+#include "ReedSolomon.h"
+#endif
+
+#include "Logger.h"
+
+#ifndef UART_PACKET_MIN_INTERVAL
+#define UART_PACKET_MIN_INTERVAL 10000
+#endif
+
+// receive errors are logged at most once per this many ms per call site,
+// the ones in between are counted into that line
+#ifndef UART_ERROR_LOG_MS
+#define UART_ERROR_LOG_MS 1000
+#endif
+
+// receive through a circular DMA buffer, frames are delimited by idle line
+// instead of polling the ring buffer and waiting for quiet gaps
+//#define UART_RX_DMA
+
+// received packets waiting for peek() / consume(), when full new packets are
+// dropped and counted (rxOverflows()), as if lost on air
+#ifndef UART_RX_QUEUE_SIZE
+#define UART_RX_QUEUE_SIZE 4
+#endif
+
+#ifndef UART_DMA_RX_BUFFER_SIZE
+#define UART_DMA_RX_BUFFER_SIZE (UART_PACKET_SIZE * 4)
+#endif
+
+// transmit from two frame buffers through DMA: the next frame is prepared while
+// the previous one is on the wire, no TX interrupt per byte, completion is
+// signalled by the DMA transfer-complete interrupt (see onTxDone())
+// one AsyncUart per firmware may use it
+//#define UART_TX_DMA
+
+// without UART_FRAMED, packets are sent as length + data + CRC (DataPacker2::writeFrame)
+// and aligned by the quiet gap between them
+
+// wrap packets in sync word + length + CRC frames (see FrameParser.h),
+// the receiver resynchronizes on its own and needs no quiet gap between packets
+//#define UART_FRAMED
+
+// encrypt and authenticate every packet (see LinkCipher.h), call secure() after begin()
+// adds up to LinkCipher::overhead bytes to each packet, handshakes are answered in update()
+//#define UART_AEAD
+
+// master / slave turn-taking on the half-duplex radio:
+// the slave (any address but controller_id) only transmits in a window right after
+// a command addressed to it, the master holds off until the reply came in or the
+// turn timed out, see clearToSend()
+//#define UART_HALF_DUPLEX
+
+// Controller polls several robots in time slots (see PollSchedule.h), needs turn-taking
+//#define UART_TDMA
+
+#if defined(UART_TDMA) && !defined(UART_HALF_DUPLEX)
+#define UART_HALF_DUPLEX
+#endif
+
+// air data rate of the radio, to size the master's turn (see e32AirtimeUs() in Airtime.h)
+#ifndef UART_AIR_RATE
+#define UART_AIR_RATE 2400
+#endif
+
+// UART baud rate between MCU and radio module, every packet crosses it twice
+#ifndef UART_MODULE_BAUD
+#define UART_MODULE_BAUD 9600
+#endif
+
+// how long the slave may take to start its reply
+#ifndef UART_REPLY_WINDOW_US
+#define UART_REPLY_WINDOW_US 20000
+#endif
+
+// radio module latency on top of the time on air
+#ifndef UART_TURN_GUARD_US
+#define UART_TURN_GUARD_US 10000
+#endif
+
+// add sequence number + timestamps to every packet, for loss / RTT / jitter (see LinkStats.h)
+//#define UART_LINK_STATS
+
+// LinkStats kept per peer address (about 150 bytes each): under UART_TDMA every
+// polled robot is a link of its own, a robot only hears the Controller and may set 1
+#ifndef UART_STATS_PEERS
+#ifdef UART_TDMA
+#define UART_STATS_PEERS 16
+#else
+#define UART_STATS_PEERS 1
+#endif
+#endif
+
+// acknowledged one-shot messages riding on the regular packets (see ReliableLane.h)
+//#define UART_ARQ
+
+// Reed-Solomon parity after every raw frame (see ReedSolomon.h), corrects
+// UART_FEC_PARITY / 2 wrong bytes before the CRC is checked
+//#define UART_FEC
+
+#ifdef UART_FEC
+#ifdef UART_FRAMED
+#error "UART_FEC protects raw frames, UART_FRAMED resynchronizes on its own"
+#endif
+#ifndef UART_FEC_PARITY
+#define UART_FEC_PARITY 4
+#endif
+#else
+#undef UART_FEC_PARITY
+#define UART_FEC_PARITY 0
+#endif
+
+#ifdef UART_AEAD
+#define UART_AEAD_OVERHEAD LinkCipher::overhead
+#else
+#define UART_AEAD_OVERHEAD 0
+#endif
+
+#ifdef UART_LINK_STATS
+#define UART_STATS_OVERHEAD LinkStats::headerSize
+#else
+#define UART_STATS_OVERHEAD 0
+#endif
+
+#ifdef UART_ARQ
+#define UART_ARQ_OVERHEAD ReliableLane<>::overhead
+#define UART_ARQ_MESSAGE_OVERHEAD ReliableLane<>::messageOverhead
+#else
+#define UART_ARQ_OVERHEAD 0
+#define UART_ARQ_MESSAGE_OVERHEAD 0
+#endif
+
+#define UART_LINK_OVERHEAD (UART_AEAD_OVERHEAD + UART_STATS_OVERHEAD + UART_ARQ_OVERHEAD)
+
+static_assert(ControlSchema::size + UART_LINK_OVERHEAD + 3 <= UART_PACKET_SIZE,
+    "control packet with link overhead does not fit in UART_PACKET_SIZE");
+static_assert(TelemetrySteps::size + UART_LINK_OVERHEAD + 3 <= UART_PACKET_SIZE,
+    "largest telemetry page with link overhead does not fit in UART_PACKET_SIZE");
+
+typedef DataPacker2<UART_PACKET_SIZE> UartData;
+
+class AsyncUart {
+public:
+    AsyncUart(HardwareSerial * port, const uint8_t address)
+        : m_port(port),
+        m_dev(port->c_dev()),
+        m_address(address) {
+    }
+
+    void begin(const uint32_t & baudrate, const uint32_t timeout = 5) {
+        m_port->begin(baudrate);
+        m_port->setTimeout(timeout);
+#ifdef UART_RX_DMA
+        beginRxDma(baudrate);
+#endif
+#ifdef UART_TX_DMA
+        beginTxDma();
+#endif
+    }
+
+#ifdef UART_TX_DMA
+    /// 'callback' runs in interrupt context whenever a frame has been handed to the USART
+    void onTxDone(void (*callback)()) {
+        m_tx_done = callback;
+    }
+
+    /// frames refused because both buffers were taken
+    inline uint16_t txOverruns() const {
+        return m_tx_overruns;
+    }
+#endif
+
+#ifdef UART_AEAD
+    /// entropy: anything that differs between boots, see bootEntropy() in BootEntropy.h
+    void secure(const uint32_t entropy, const uint8_t * key = link_key) {
+        // a polled robot is silent for a whole cycle, that is no reason to renew its challenge
+        m_cipher.begin(key, entropy, linkTimeoutMs() > LINK_CIPHER_RESYNC_MS ? linkTimeoutMs() : LINK_CIPHER_RESYNC_MS);
+    }
+#endif
+
+    /// bytes on the wire for a payload of 'payload' bytes, with all link overhead
+    static constexpr uint8_t frameBytes(const uint8_t payload) {
+#ifdef UART_FRAMED
+        return payload + UART_LINK_OVERHEAD + FRAME_OVERHEAD;
+#else
+        return payload + UART_LINK_OVERHEAD + 3 + UART_FEC_PARITY;
+#endif
+    }
+
+    /// one master / slave exchange with these payload sizes, in microseconds,
+    /// either packet may carry a reliable lane message on top
+    static uint32_t turnUs(const uint8_t command_payload, const uint8_t reply_payload) {
+        return turnAirtimeUs(worstFrameBytes(command_payload), worstFrameBytes(reply_payload),
+            UART_AIR_RATE, UART_MODULE_BAUD, UART_REPLY_WINDOW_US, UART_TURN_GUARD_US);
+    }
+
+    /// silence after which the peer counts as gone: LINK_TIMEOUT_MS, under UART_TDMA
+    /// stretched to the poll cycle of TDMA_ROBOTS robots (see pollTimeoutMs())
+    static uint32_t linkTimeoutMs() {
+#ifdef UART_TDMA
+        return pollTimeoutMs(TDMA_ROBOTS, turnUs(ControlSchema::size, TelemetrySteps::size), LINK_TIMEOUT_MS);
+#else
+        return LINK_TIMEOUT_MS;
+#endif
+    }
+
+    /// send the occupied bytes of 'data', frame length follows data.length()
+    /// master: 'turn_us' overrides how long to wait for the reply (0: sized for the largest reply)
+    /// return false if it is not our turn to talk (UART_HALF_DUPLEX) or the packet is too long
+    bool write(const UartData & data, const uint32_t turn_us = 0) {
+        if (!clearToSend()) {
+            m_turn_blocked++;
+            return false;
+        }
+#ifdef UART_TX_DMA
+        // one frame on the wire, one waiting: nowhere to prepare this one
+        if (m_tx_queued) {
+            m_tx_overruns++;
+            return false;
+        }
+        uint8_t * const frame = m_tx_frame[1 - m_tx_wire];
+#else
+        uint8_t * const frame = m_tx_frame;
+#endif
+
+        m_busy = true;
+        m_out_data = data;
+#ifdef UART_ARQ
+        {
+            const uint8_t length = m_out_data.length();
+            // checked before subtracting: a nearly full payload would wrap 'room' around
+            if (length + UART_LINK_OVERHEAD + 3 > m_out_data.size()) {
+                ERRORF("packet too long for the reliable lane: %d", length);
+                m_busy = false;
+                return false;
+            }
+            const uint8_t room = m_out_data.size() - 3 - length - UART_AEAD_OVERHEAD - UART_STATS_OVERHEAD;
+            const uint8_t to = LinkField::to(m_out_data.get<LinkField::Address>());
+            m_out_data.setLength(length + m_lane.attach(m_out_data.getBuffer() + length, room, to, millis()));
+        }
+#endif
+#ifdef UART_LINK_STATS
+        // stats header goes last so payload offsets stay the same
+        const uint8_t length = m_out_data.length();
+        if (length + LinkStats::headerSize > m_out_data.size() - 3) {
+            ERRORF("packet too long for stats header: %d", length);
+            m_busy = false;
+            return false;
+        }
+        m_stats_peer = LinkField::to(m_out_data.get<LinkField::Address>());
+        stats(m_stats_peer).stamp(m_out_data.getBuffer() + length, millis());
+        m_out_data.setLength(length + LinkStats::headerSize);
+#endif
+#ifdef UART_AEAD
+        const uint8_t sealed = m_cipher.seal(m_out_data.getBuffer(), m_out_data.length(), m_out_data.size() - 3, millis());
+        if (sealed == 0) {
+            ERRORF("packet too long to seal: %d", m_out_data.length());
+            m_busy = false;
+            return false;
+        }
+        m_out_data.setLength(sealed);
+#endif
+#ifdef UART_FRAMED
+        const uint8_t frame_size = encodeFrame(m_out_data.getBuffer(), m_out_data.length(), frame);
+#else
+        uint8_t frame_size = m_out_data.writeFrame(frame);
+#ifdef UART_FEC
+        m_fec.encode(frame, frame_size);
+        frame_size += UART_FEC_PARITY;
+#endif
+#endif
+#ifdef UART_TX_DMA
+        noInterrupts();
+        if (m_tx_running) {
+            // goes out from the completion interrupt, right after the current one
+            m_tx_queued_size = frame_size;
+            m_tx_queued = true;
+        }
+        else
+            startTxDma(1 - m_tx_wire, frame_size);
+        interrupts();
+#else
+        usart_reset_tx(m_dev);
+        usart_tx(m_dev, frame, frame_size);
+#endif
+
+#ifdef UART_HALF_DUPLEX
+        if (m_master) {
+            // our frame travels, the slave answers within its window, its reply travels back
+            m_waiting_reply = true;
+            m_turn_start_us = micros();
+            m_turn_length_us = turn_us > 0 ? turn_us
+                : turnAirtimeUs(frame_size, tx_frame_size, UART_AIR_RATE, UART_MODULE_BAUD,
+                    UART_REPLY_WINDOW_US, UART_TURN_GUARD_US);
+        }
+        else
+            m_reply_open = false;   // one reply per command
+#endif
+        return true;
+    }
+
+    /// true if write() may transmit now
+    bool clearToSend() {
+#ifdef UART_HALF_DUPLEX
+        const uint32_t elapsed_us = micros() - m_turn_start_us;
+        if (m_master) {
+            if (m_waiting_reply && elapsed_us >= m_turn_length_us) {
+                m_waiting_reply = false;
+                m_turn_timeouts++;
+            }
+            return !m_waiting_reply;
+        }
+        if (m_reply_open && elapsed_us >= UART_REPLY_WINDOW_US)
+            m_reply_open = false;
+        return m_reply_open;
+#else
+        return true;
+#endif
+    }
+
+#ifdef UART_ARQ
+    /// queue 'data' for acknowledged delivery to 'to', it goes out with the next packets
+    bool sendReliable(const uint8_t to, const uint8_t * data, const uint8_t length) {
+        return m_lane.send(to, data, length);
+    }
+
+    /// received messages, retransmit / duplicate / failure counters
+    inline ReliableLane<> & lane() {
+        return m_lane;
+    }
+#endif
+
+    /// writes refused because it was not our turn
+    inline uint16_t turnBlocked() const {
+        return m_turn_blocked;
+    }
+
+    /// master only: turns that ended without a reply
+    inline uint16_t turnTimeouts() const {
+        return m_turn_timeouts;
+    }
+
+    /// oldest received packet, valid until consume()
+    inline const UartData & peek() const {
+        return m_rx_queue[m_rx_head];
+    }
+
+    /// done with the packet from peek()
+    void consume() {
+        if (m_rx_count == 0)
+            return;
+        m_rx_head = (m_rx_head + 1) % UART_RX_QUEUE_SIZE;
+        m_rx_count--;
+        m_rx_error = false;
+    }
+
+    /// hand every queued packet to the handler for its message type, in place
+    /// (see MessageTable in RobotProtocol.h), return packets handled
+    template <typename Table>
+    uint8_t dispatch() {
+        uint8_t handled = 0;
+        while (m_rx_count > 0) {
+            const UartData & packet = peek();
+            const uint8_t type = LinkField::type(packet);
+            if (Table::dispatch(type, packet))
+                handled++;
+            else {
+                m_rx_unhandled++;
+                WARNF_EVERY(UART_ERROR_LOG_MS, "no handler for type %u, %u bytes", type, packet.length());
+            }
+            consume();
+        }
+        return handled;
+    }
+
+    /// packets no handler took: unknown type or too short
+    inline uint16_t rxUnhandled() const {
+        return m_rx_unhandled;
+    }
+
+    /// packets waiting to be consumed
+    inline uint8_t queued() const {
+        return m_rx_count;
+    }
+
+    /// packets dropped because the queue was full
+    inline uint16_t rxOverflows() const {
+        return m_rx_overflows;
+    }
+
+    void update() {
+        const uint32_t current_us = micros();
+
+        SCHEDULER_GUARD(current_us, m_last_rx_us);
+        SCHEDULER_GUARD(current_us, m_last_tx_us);
+
+#ifdef UART_ARQ
+        m_lane.update(millis());
+#endif
+
+#ifndef UART_TX_DMA
+        if (isTxBufferEmpty()
+            && current_us > m_last_tx_us + 2000)
+            m_busy = false;
+#endif
+
+#ifdef UART_RX_DMA
+#ifdef UART_FRAMED
+        // framing is in-band, take whatever the DMA has written so far
+        m_rx_ring.onIdle(dma_get_count(DMA1, m_rx_dma_channel));
+        __asm__ volatile("" ::: "memory");
+#else
+        // IDLE is cleared by reading SR then DR
+        if (m_dev->regs->SR & USART_SR_IDLE) {
+            (void)m_dev->regs->DR;
+            m_rx_remaining = dma_get_count(DMA1, m_rx_dma_channel);
+            m_rx_ring.onIdle(m_rx_remaining);
+            // DMA wrote the ring behind the compiler's back
+            __asm__ volatile("" ::: "memory");
+        }
+#endif
+
+        while (m_rx_ring.available()) {
+            const auto & frame = m_rx_ring.peek();
+#ifdef UART_FRAMED
+            for (uint16_t i = 0; i < frame.length; ++i)
+                feedParser(m_rx_ring.at(frame, i), current_us);
+#else
+            // back-to-back packets without a gap show up as one frame
+            uint16_t i = 0;
+            bool cut = false;
+            while (i < frame.length) {
+                uint16_t size = m_rx_ring.at(frame, i) + 3 + UART_FEC_PARITY;
+                // IDLE polled late, while the next packet was coming in: keep its start for the next frame
+                if (i + size > frame.length && size <= sizeof(m_rx_frame) && rxArriving()) {
+                    cut = true;
+                    break;
+                }
+#ifdef UART_FEC
+                // length byte hit by noise: a lone frame in the burst is still a full codeword
+                if (i == 0 && (size > sizeof(m_rx_frame) || size > frame.length)
+                    && frame.length <= sizeof(m_rx_frame))
+                    size = frame.length;
+#endif
+                if (size > sizeof(m_rx_frame) || i + size > frame.length) {
+                    ERRORF_EVERY(UART_ERROR_LOG_MS, "frame size %d", frame.length - i);
+                    break;
+                }
+                m_last_rx_us = current_us;
+                m_rx_ring.copy(frame, i, m_rx_frame, size);
+                acceptPacket(size);
+                i += size;
+            }
+            if (cut) {
+                m_rx_ring.pop(i);
+                break;
+            }
+#endif
+            m_rx_ring.pop();
+        }
+#elif defined(UART_FRAMED)
+        while (m_port->available() > 0)
+            feedParser(m_port->read(), current_us);
+#else
+        // clean buffer if trash received
+        if (current_us < m_last_rx_us + UART_PACKET_MIN_INTERVAL)
+            usart_reset_rx(m_dev);
+
+        const int available = m_port->available();
+        if (available > 0) {
+            const int size = m_port->peek() + 3 + UART_FEC_PARITY;
+
+            if (size > (int)sizeof(m_rx_frame)) {
+                ERRORF_EVERY(UART_ERROR_LOG_MS, "frame size %d", size);
+                usart_reset_rx(m_dev);
+            }
+            else if (available >= size) {
+                m_last_rx_us = current_us;
+                m_port->readBytes(m_rx_frame, size);
+                acceptPacket(size);
+            }
+        }
+#endif
+
+#ifdef UART_AEAD
+        // a peer (re)started the handshake: any packet to it carries our new challenge
+        const int8_t hello_to = m_cipher.helloDue();
+        if (hello_to >= 0 && clearToSend()) {
+            UartData hello;
+            hello.put<LinkField::Address>(LinkField::pack(m_address, hello_to));
+            write(hello);
+        }
+#endif
+    }
+
+    bool available() {
+        return m_rx_count > 0;
+    }
+
+    bool rx_error() {
+        const auto e = m_rx_error;
+        m_rx_error = false;
+        return e;
+    }
+
+    bool busy() {
+#ifdef UART_TX_DMA
+        return m_tx_running;
+#else
+        return m_busy;
+#endif
+    }
+
+#ifdef UART_FEC
+    /// bytes repaired by FEC so far
+    inline uint16_t fecCorrected() const {
+        return m_fec_corrected;
+    }
+#endif
+
+#ifdef UART_LINK_STATS
+    /// loss, errors, RTT and jitter of the link with 'peer'
+    /// over the last LINK_STATS_BUCKETS x LINK_STATS_BUCKET_MS
+    LinkQuality quality(const uint8_t peer) {
+        return stats(peer).quality(millis());
+    }
+
+    /// sender's timestamp of the packet at peek(), see LinkStats::peerTime()
+    uint32_t peerTime() const {
+        return m_rx_peer_ms[m_rx_head];
+    }
+
+    void logQuality(const uint8_t peer) {
+        const LinkQuality q = quality(peer);
+        INFOF("link %u rx %u lost %u%% err %u%% rtt %u/%u ms jitter %u ms overflow %u",
+            peer, q.received, q.loss_percent, q.error_percent, q.rtt_ms, q.rtt_max_ms, q.jitter_ms, m_rx_overflows);
+    }
+#endif
+private:
+    /// frameBytes() with the largest reliable lane message attached, never above a full packet
+    static constexpr uint8_t worstFrameBytes(const uint8_t payload) {
+        return frameBytes(payload + UART_ARQ_MESSAGE_OVERHEAD) < tx_frame_size
+            ? frameBytes(payload + UART_ARQ_MESSAGE_OVERHEAD) : tx_frame_size;
+    }
+
+#ifdef UART_LINK_STATS
+    inline LinkStats & stats(const uint8_t peer) {
+        return m_stats[peer % UART_STATS_PEERS];
+    }
+#endif
+
+#ifndef UART_FRAMED
+    void acceptPacket(uint8_t size) {
+#ifdef UART_FEC
+        const int8_t corrected = m_fec.decode(m_rx_frame, size);
+        if (corrected < 0) {
+            rejectPacket();
+            ERROR_EVERY(UART_ERROR_LOG_MS, "FEC uncorrectable");
+            return;
+        }
+        m_fec_corrected += corrected;
+        size -= UART_FEC_PARITY;
+        // the corrected length byte must agree with the codeword we cut out
+        if (m_rx_frame[0] + 3 != size) {
+            rejectPacket();
+            ERRORF_EVERY(UART_ERROR_LOG_MS, "frame size %d", size);
+            return;
+        }
+#endif
+        UartData * const packet = rxSlot();
+        if (packet == nullptr)
+            return;
+        if (packet->readFrame(m_rx_frame, size))
+            dispatchPacket(*packet);
+        else {
+            rejectPacket();
+            ERROR_EVERY(UART_ERROR_LOG_MS, "CRC error");
+        }
+    }
+#endif
+
+    /// check and strip the link layers of a packet in the queue's free slot, queue it if it is ours
+    void dispatchPacket(UartData & packet) {
+        const auto address = packet.get<LinkField::Address>();
+        //DEBUGF("msg from %d to %d", LinkField::from(address), LinkField::to(address));
+
+        if (LinkField::to(address) != m_address)
+            return;
+
+#ifdef UART_AEAD
+        const int16_t length = m_cipher.open(packet.getBuffer(), packet.length(), millis());
+        if (length < 0) {
+            rejectPacket();
+            ERROR_EVERY(UART_ERROR_LOG_MS, "auth error");
+            return;
+        }
+        if (length == 0) {
+            // handshake: nothing to deliver, update() answers with our challenge
+            openTurn();
+            return;
+        }
+        packet.setLength(length);
+#endif
+#ifdef UART_LINK_STATS
+        if (packet.length() < LinkStats::headerSize) {
+            rejectPacket();
+            ERRORF_EVERY(UART_ERROR_LOG_MS, "packet too short: %d", packet.length());
+            return;
+        }
+        const uint8_t payload = packet.length() - LinkStats::headerSize;
+        stats(LinkField::from(address)).receive(packet.getBuffer() + payload, millis());
+        packet.setLength(payload);
+#endif
+#ifdef UART_ARQ
+        const int16_t trailer = m_lane.detach(packet.getBuffer(), packet.length(),
+            LinkField::from(address), millis());
+        if (trailer < 0) {
+            rejectPacket();
+            ERROR_EVERY(UART_ERROR_LOG_MS, "bad reliable lane trailer");
+            return;
+        }
+        packet.setLength(packet.length() - trailer);
+#endif
+        // address byte only: a link-level packet (handshake answer, lane ack), nothing to queue
+        if (packet.length() > 1) {
+#ifdef UART_LINK_STATS
+            m_rx_peer_ms[(m_rx_head + m_rx_count) % UART_RX_QUEUE_SIZE] = stats(LinkField::from(address)).peerTime();
+#endif
+            m_rx_count++;
+        }
+        openTurn();
+    }
+
+    /// a packet for us came in: the master's turn is over, the slave may answer
+    void openTurn() {
+#ifdef UART_HALF_DUPLEX
+        if (m_master)
+            m_waiting_reply = false;    // reply is in, the line is free
+        else {
+            m_reply_open = true;        // our turn to answer
+            m_turn_start_us = micros();
+        }
+#endif
+    }
+
+    /// free slot at the end of the queue, nullptr (and counted) when full
+    UartData * rxSlot() {
+        if (m_rx_count == UART_RX_QUEUE_SIZE) {
+            m_rx_overflows++;
+            return nullptr;
+        }
+        return &m_rx_queue[(m_rx_head + m_rx_count) % UART_RX_QUEUE_SIZE];
+    }
+
+    void rejectPacket() {
+        m_rx_error = true;
+#ifdef UART_LINK_STATS
+        // the sender of a damaged frame is unknown, in turn-taking it can only be
+        // the one we last talked to
+        stats(m_stats_peer).onError(millis());
+#endif
+    }
+
+#ifdef UART_FRAMED
+    void feedParser(const uint8_t byte, const uint32_t current_us) {
+        m_parser.feed(byte);
+        while (m_parser.next()) {
+            if (m_parser.length() > UART_PACKET_SIZE - 3) {
+                ERRORF_EVERY(UART_ERROR_LOG_MS, "frame size %u", m_parser.length());
+                continue;
+            }
+            m_last_rx_us = current_us;
+            UartData * const packet = rxSlot();
+            if (packet == nullptr)
+                continue;
+            packet->clear();
+            packet->clone(m_parser.payload(), 0, m_parser.length());
+            packet->setLength(m_parser.length());
+            packet->putCRC();
+            dispatchPacket(*packet);
+        }
+
+        if (m_parser.errors() != m_parser_errors) {
+            m_parser_errors = m_parser.errors();
+            rejectPacket();
+            ERROR_EVERY(UART_ERROR_LOG_MS, "CRC error");
+        }
+    }
+#endif
+
+#ifdef UART_RX_DMA
+    static dma_channel rxDmaChannel(usart_dev * dev) {
+        if (dev == USART2)
+            return DMA_CH6;
+        if (dev == USART3)
+            return DMA_CH3;
+        return DMA_CH5;
+    }
+
+#ifndef UART_FRAMED
+    /// bytes written since the last IDLE snapshot or within the next two characters
+    bool rxArriving() const {
+        const uint32_t start = micros();
+        do {
+            if (dma_get_count(DMA1, m_rx_dma_channel) != m_rx_remaining)
+                return true;
+        } while (micros() - start < 2 * m_rx_char_us);
+        return false;
+    }
+#endif
+
+    void beginRxDma(const uint32_t baudrate) {
+        m_rx_dma_channel = rxDmaChannel(m_dev);
+        m_rx_ring.clear();
+        m_rx_remaining = m_rx_ring.capacity();
+        m_rx_char_us = 10000000UL / baudrate + 1;
+
+        // bytes go straight to memory, no RXNE interrupt per byte
+        m_dev->regs->CR1 &= ~USART_CR1_RXNEIE;
+
+        dma_init(DMA1);
+        dma_setup_transfer(DMA1, m_rx_dma_channel,
+            &m_dev->regs->DR, DMA_SIZE_8BITS,
+            m_rx_ring.buffer(), DMA_SIZE_8BITS,
+            DMA_MINC_MODE | DMA_CIRC_MODE);
+        dma_set_num_transfers(DMA1, m_rx_dma_channel, m_rx_ring.capacity());
+        dma_set_priority(DMA1, m_rx_dma_channel, DMA_PRIORITY_HIGH);
+        dma_enable(DMA1, m_rx_dma_channel);
+
+        m_dev->regs->CR3 |= USART_CR3_DMAR;
+    }
+#endif
+
+#ifdef UART_TX_DMA
+    static dma_channel txDmaChannel(usart_dev * dev) {
+        if (dev == USART2)
+            return DMA_CH7;
+        if (dev == USART3)
+            return DMA_CH2;
+        return DMA_CH4;
+    }
+
+    /// the DMA interrupt has no context argument, it goes to the one instance using TX DMA
+    static AsyncUart *& txDmaOwner() {
+        static AsyncUart * owner = nullptr;
+        return owner;
+    }
+
+    static void txDmaIrq() {
+        txDmaOwner()->txComplete();
+    }
+
+    void beginTxDma() {
+        m_tx_dma_channel = txDmaChannel(m_dev);
+        m_tx_running = false;
+        m_tx_queued = false;
+        txDmaOwner() = this;
+
+        dma_init(DMA1);
+        dma_attach_interrupt(DMA1, m_tx_dma_channel, txDmaIrq);
+        m_dev->regs->CR3 |= USART_CR3_DMAT;
+    }
+
+    /// call with interrupts off
+    void startTxDma(const uint8_t index, const uint8_t size) {
+        m_tx_wire = index;
+        m_tx_running = true;
+
+        dma_disable(DMA1, m_tx_dma_channel);
+        dma_setup_transfer(DMA1, m_tx_dma_channel,
+            &m_dev->regs->DR, DMA_SIZE_8BITS,
+            m_tx_frame[index], DMA_SIZE_8BITS,
+            DMA_MINC_MODE | DMA_FROM_MEM | DMA_TRNS_CMPLT);
+        dma_set_num_transfers(DMA1, m_tx_dma_channel, size);
+        m_dev->regs->SR &= ~USART_SR_TC;
+        dma_enable(DMA1, m_tx_dma_channel);
+    }
+
+    /// DMA transfer complete: the last byte is in the USART, the next frame may follow
+    void txComplete() {
+        if (m_tx_queued) {
+            m_tx_queued = false;
+            startTxDma(1 - m_tx_wire, m_tx_queued_size);
+        }
+        else
+            m_tx_running = false;
+        if (m_tx_done != nullptr)
+            m_tx_done();
+    }
+#endif
+
+    bool isTxBufferEmpty() {
+        constexpr auto _USART_SR_TC_BIT_ = 6;
+        if (rb_is_empty(m_dev->wb)								// wait for TX buffer empty
+            && ((m_dev->regs->SR) & (1 << _USART_SR_TC_BIT_)))	// wait for TC (Transmission Complete) flag set
+                                                                  // at least 2ms after buffer is empty
+            return true;
+        return false;
+    }
+
+    HardwareSerial * const m_port;
+    usart_dev * const m_dev;
+    const uint8_t m_address;
+
+    UartData m_out_data;
+    bool m_rx_error{ false };
+
+    UartData m_rx_queue[UART_RX_QUEUE_SIZE];
+    uint8_t m_rx_head{ 0 };
+    uint8_t m_rx_count{ 0 };
+    uint16_t m_rx_overflows{ 0 };
+    uint16_t m_rx_unhandled{ 0 };
+#ifdef UART_LINK_STATS
+    uint32_t m_rx_peer_ms[UART_RX_QUEUE_SIZE]{};
+#endif
+    bool m_busy{ false };
+
+    uint32_t m_last_tx_us{ 0 };
+    uint32_t m_last_rx_us{ 0 };
+
+#ifdef UART_RX_DMA
+    DmaRxRing<UART_DMA_RX_BUFFER_SIZE> m_rx_ring;
+    dma_channel m_rx_dma_channel{ DMA_CH5 };
+    uint16_t m_rx_remaining{ 0 };
+    uint32_t m_rx_char_us{ 0 };
+#endif
+
+#ifdef UART_FRAMED
+    FrameParser<UART_PACKET_SIZE> m_parser;
+    uint16_t m_parser_errors{ 0 };
+#else
+    uint8_t m_rx_frame[UartData::maxFrameSize() + UART_FEC_PARITY];
+#endif
+    static constexpr uint8_t tx_frame_size = UART_PACKET_SIZE + FRAME_OVERHEAD + UART_FEC_PARITY;
+#ifdef UART_TX_DMA
+    // one on the wire (m_tx_wire), the other one being prepared or queued
+    uint8_t m_tx_frame[2][tx_frame_size];
+    volatile uint8_t m_tx_wire{ 0 };
+    volatile bool m_tx_running{ false };
+    volatile bool m_tx_queued{ false };
+    volatile uint8_t m_tx_queued_size{ 0 };
+    dma_channel m_tx_dma_channel{ DMA_CH4 };
+    void (*m_tx_done)(){ nullptr };
+    uint16_t m_tx_overruns{ 0 };
+#else
+    uint8_t m_tx_frame[tx_frame_size];
+#endif
+
+#ifdef UART_AEAD
+    LinkCipher m_cipher;
+#endif
+
+#ifdef UART_LINK_STATS
+    LinkStats m_stats[UART_STATS_PEERS];
+    uint8_t m_stats_peer{ 0 };
+#endif
+
+#ifdef UART_ARQ
+    ReliableLane<> m_lane;
+#endif
+
+#ifdef UART_FEC
+    ReedSolomon<UART_FEC_PARITY> m_fec;
+    uint16_t m_fec_corrected{ 0 };
+#endif
+
+#ifdef UART_HALF_DUPLEX
+    const bool m_master{ m_address == controller_id };
+    bool m_waiting_reply{ false };
+    bool m_reply_open{ false };
+    uint32_t m_turn_start_us{ 0 };
+    uint32_t m_turn_length_us{ 0 };
+#endif
+    uint16_t m_turn_blocked{ 0 };
+    uint16_t m_turn_timeouts{ 0 };
+};
@@ -0,0 +1,270 @@
+#pragma once
+
+/*
+* ---BlackBox---
+* What the robot was doing before a watchdog, software or pin reset: the last
+* log lines and a snapshot of sketch state, kept in RAM that the startup code
+* neither copies nor clears, read back on the next boot together with the
+* reset cause from RCC_CSR.
+*
+*    struct RobotState { ... };                  // plain data, copied with memcpy
+*    BlackBox<RobotState> black_box BLACKBOX_NOINIT;
+*
+*    setup():  black_box.begin();                // before anything is logged
+*              ... report black_box.resetCause(), state(), replay(sink) ...
+*              black_box.start();                // forget the previous run, record this one
+*    logging:  black_box.log(buffer, length);    // from the flushPipe function
+*    loop():   black_box.snapshot(state, millis());
+*
+* Every line and each of the two state copies carries its own CRC, so a write
+* cut short by the reset only loses itself; nothing is recomputed over the
+* whole box per write. A header with a magic value and CRC tells a warm reset
+* from power-on garbage. Lines are stored as handed over: text, or in a
+* LOG_DEFERRED build one drain chunk per line, always whole records
+* (DeferredLog::drain() never splits one), which extras/logdecode.py reads as well.
+*
+* The stock libmaple linker script has no .noinit, extras/noinit.ld adds it
+* (see there how to hook it in). begin() refers to the __noinit_start /
+* __noinit_end symbols it defines, so a build without it fails to link
+* instead of losing the box on every reset; placed() tells whether the box
+* itself was declared BLACKBOX_NOINIT.
+* The box must not have a constructor either, it would run on every boot,
+* hence plain members only and State stored as bytes.
+* ------------------
+*/
+
+#include "Arduino.h"
+#include <stdint.h>
+#include <string.h>
+#include "crc16.h"
+
+#ifndef BLACKBOX_NOINIT
+#define BLACKBOX_NOINIT		__attribute__((section(".noinit")))
+#endif
+
+// defined by extras/noinit.ld, an undefined reference here means it is missing from the link
+extern "C" char __noinit_start[];
+extern "C" char __noinit_end[];
+
+// STM32F1 RCC_CSR: reset flags in bit 31..26, writing RMVF (bit 24) clears them
+#define BLACKBOX_RCC_CSR		(*(volatile uint32_t *)0x40021024)
+#define BLACKBOX_RCC_RMVF		(1UL << 24)
+#define BLACKBOX_RESET_PIN		(1UL << 26)
+#define BLACKBOX_RESET_POR		(1UL << 27)
+#define BLACKBOX_RESET_SOFTWARE	(1UL << 28)
+#define BLACKBOX_RESET_IWDG		(1UL << 29)
+#define BLACKBOX_RESET_WWDG		(1UL << 30)
+#define BLACKBOX_RESET_LOW_POWER	(1UL << 31)
+
+template <typename State, uint8_t lineCount = 8, uint8_t lineSize = 64>
+class BlackBox
+{
+public:
+	typedef void(*Sink)(const char * buffer, const uint8_t length);
+
+	static constexpr uint32_t magic = 0x424C4258;	// "BLBX"
+
+	/// first thing in setup(): read and clear the reset flags, check what the
+	/// previous run left behind, recording stays off until start()
+	void begin() {
+		m_reset_flags = BLACKBOX_RCC_CSR;
+		BLACKBOX_RCC_CSR |= BLACKBOX_RCC_RMVF;
+		m_recording = false;
+
+		m_placed = (const char *)this >= __noinit_start && (const char *)(this + 1) <= __noinit_end;
+		m_recovered = m_placed && m_magic == magic && m_header_crc == headerCRC();
+		m_resets = m_recovered ? m_resets + 1 : 0;
+		m_magic = magic;
+		m_header_crc = headerCRC();
+		if (!m_recovered)
+			clear();
+	}
+
+	/// forget the previous run and record this one
+	void start() {
+		clear();
+		m_seq = 0;
+		m_state_seq = 0;
+		m_recording = true;
+	}
+
+	/// a finished log line, same signature as Logger::flushPipe
+	void log(const char * buffer, uint8_t length) {
+		if (!m_recording)
+			return;
+		Line & line = m_lines[m_seq % lineCount];
+		if (length > lineSize) {
+			length = lineSize;
+			memcpy(line.text, buffer, length - 2);
+			line.text[length - 2] = '\r';
+			line.text[length - 1] = '\n';
+		}
+		else
+			memcpy(line.text, buffer, length);
+		line.seq = m_seq++;
+		line.length = length;
+		line.crc = lineCRC(line);
+	}
+
+	/// alternates between two copies, a torn write leaves the older one
+	void snapshot(const State & state, const uint32_t now) {
+		if (!m_recording)
+			return;
+		if (++m_state_seq == 0)
+			m_state_seq = 1;
+		Snapshot & s = m_states[m_state_seq & 1];
+		s.seq = m_state_seq;
+		s.ms = now;
+		memcpy(s.data, &state, sizeof(State));
+		s.crc = snapshotCRC(s);
+	}
+
+	/// newest state the previous run saved, false if none survived
+	bool state(State & state, uint32_t & ms) const {
+		const Snapshot * newest = nullptr;
+		for (const Snapshot & s : m_states) {
+			if (!valid(s))
+				continue;
+			if (newest == nullptr || (int16_t)(s.seq - newest->seq) > 0)
+				newest = &s;
+		}
+		if (newest == nullptr)
+			return false;
+		memcpy(&state, newest->data, sizeof(State));
+		ms = newest->ms;
+		return true;
+	}
+
+	/// the previous run's lines, oldest first, return how many were intact
+	uint8_t replay(Sink sink) const {
+		const Line * newest = nullptr;
+		for (const Line & line : m_lines) {
+			if (!valid(line))
+				continue;
+			if (newest == nullptr || (int16_t)(line.seq - newest->seq) > 0)
+				newest = &line;
+		}
+		if (newest == nullptr)
+			return 0;
+
+		uint8_t count = 0;
+		for (uint8_t i = lineCount; i > 0; --i) {
+			const uint16_t seq = newest->seq - (i - 1);
+			const Line & line = m_lines[seq % lineCount];
+			if (line.seq == seq && valid(line)) {
+				sink(line.text, line.length);
+				count++;
+			}
+		}
+		return count;
+	}
+
+	/// the box held a previous run (warm reset), false after power-on
+	inline bool recovered() const {
+		return m_recovered;
+	}
+
+	/// the box lies in .noinit, false if it was declared without BLACKBOX_NOINIT
+	inline bool placed() const {
+		return m_placed;
+	}
+
+	/// warm resets since power-on
+	inline uint16_t resets() const {
+		return m_resets;
+	}
+
+	/// RCC_CSR as read by begin()
+	inline uint32_t resetFlags() const {
+		return m_reset_flags;
+	}
+
+	/// most specific flag first, an internal reset also drives NRST so PIN comes last
+	const char * resetCause() const {
+		if (m_reset_flags & BLACKBOX_RESET_LOW_POWER)
+			return "low-power";
+		if (m_reset_flags & BLACKBOX_RESET_WWDG)
+			return "window watchdog";
+		if (m_reset_flags & BLACKBOX_RESET_IWDG)
+			return "watchdog";
+		if (m_reset_flags & BLACKBOX_RESET_SOFTWARE)
+			return "software";
+		if (m_reset_flags & BLACKBOX_RESET_POR)
+			return "power-on";
+		if (m_reset_flags & BLACKBOX_RESET_PIN)
+			return "pin";
+		return "unknown";
+	}
+
+private:
+	static_assert((lineCount & (lineCount - 1)) == 0, "lineCount must be a power of 2, line slots follow the 16-bit sequence");
+	static_assert(lineSize >= 2, "lines end with \\r\\n");
+#ifdef LOG_DRAIN_CHUNK
+	static_assert(lineSize >= LOG_DRAIN_CHUNK, "a drain chunk of deferred records must fit in one line, a cut would break its last record");
+#endif
+
+	struct Line {
+		uint16_t seq;
+		uint16_t crc;
+		uint8_t length;
+		char text[lineSize];
+	};
+
+	struct Snapshot {
+		uint16_t seq;		// 0: never written
+		uint16_t crc;
+		uint32_t ms;
+		uint8_t data[sizeof(State)];
+	};
+
+	static uint16_t lineCRC(const Line & line) {
+		Crc16 crc;
+		crc.update((const uint8_t *)&line.seq, sizeof(line.seq));
+		crc.update(line.length);
+		crc.update((const uint8_t *)line.text, line.length);
+		return crc.value();
+	}
+
+	static uint16_t snapshotCRC(const Snapshot & s) {
+		Crc16 crc;
+		crc.update((const uint8_t *)&s.seq, sizeof(s.seq));
+		crc.update((const uint8_t *)&s.ms, sizeof(s.ms));
+		crc.update(s.data, sizeof(State));
+		return crc.value();
+	}
+
+	static inline bool valid(const Line & line) {
+		return line.length > 0 && line.length <= lineSize && line.crc == lineCRC(line);
+	}
+
+	static inline bool valid(const Snapshot & s) {
+		return s.seq != 0 && s.crc == snapshotCRC(s);
+	}
+
+	uint16_t headerCRC() const {
+		Crc16 crc;
+		crc.update((const uint8_t *)&m_magic, sizeof(m_magic));
+		crc.update((const uint8_t *)&m_resets, sizeof(m_resets));
+		return crc.value();
+	}
+
+	void clear() {
+		memset(m_lines, 0, sizeof(m_lines));
+		memset(m_states, 0, sizeof(m_states));
+	}
+
+	// no initializers: anything here would be overwritten on every boot
+	uint32_t m_magic;
+	uint16_t m_resets;
+	uint16_t m_header_crc;
+	Line m_lines[lineCount];
+	Snapshot m_states[2];
+
+	// this run only, set by begin() / start()
+	uint32_t m_reset_flags;
+	uint16_t m_seq;
+	uint16_t m_state_seq;
+	bool m_recording;
+	bool m_recovered;
+	bool m_placed;
+};
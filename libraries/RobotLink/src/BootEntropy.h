@@ -0,0 +1,37 @@
+#pragma once
+
+/*
+* ---BootEntropy---
+* 32 bits that differ between boots and between boards, to seed LinkCipher.
+* The F103 has no hardware RNG, this folds together:
+*    the 96-bit unique device ID            (differs between boards)
+*    64 conversions of the internal temperature sensor and Vrefint,
+*    all 12 bits, not only the LSB          (thermal and reference noise)
+*    the SysTick phase after each conversion
+* through HalfSipHash keyed with the link key, so a weak source cannot
+* cancel a good one. Call it once in setup(), it takes about 0.5 ms.
+* ------------------
+*/
+
+#include <libmaple/adc.h>
+#include <libmaple/systick.h>
+#include "LinkCipher.h"
+#include "RobotProtocol.h"
+
+// 96-bit unique device ID, RM0008 30.2
+#define BOOT_ENTROPY_UID	((const uint8_t *)0x1FFFF7E8)
+
+inline uint32_t bootEntropy(const uint8_t * key = link_key) {
+	uint8_t pool[12 + 2 * 64];
+	memcpy(pool, BOOT_ENTROPY_UID, 12);
+
+	// temperature sensor (channel 16) and Vrefint (channel 17) need TSVREFE and 10 us to start
+	ADC1->regs->CR2 |= ADC_CR2_TSVREFE;
+	delayMicroseconds(10);
+	for (uint8_t i = 0; i < 64; ++i) {
+		const uint16_t sample = adc_read(ADC1, 16 + (i & 1)) ^ (systick_get_count() << 4);
+		pool[12 + 2 * i] = sample;
+		pool[13 + 2 * i] = sample >> 8;
+	}
+	return halfSipHash24(key, pool, sizeof(pool));
+}
@@ -11,6 +11,14 @@
 *    n bytes      +   1 byte      +  2 bytes = packetSize
 *
 * Note: CRC calculates all bytes (except for CRC bytes itself), including not occupied bytes
+*
+* Variable-length frame (writeFrame / readFrame), only occupied bytes are carried:
+*    length   +  [data]   +   CRC
+*    1 byte   +  length   +  2 bytes
+* CRC covers length and data.
+*
+* Members can be accessed by index through a size map (push / get<T>(index)),
+* or by compile-time field types (put<Field> / get<Field>(), see PacketSchema.h)
 * ------------------
 * author: maisonsmd
 * contact: maisonsmd@gmail.com
@@ -18,6 +26,7 @@
 
 #include "Arduino.h"
 #include "crc16.h"
+#include "PacketSchema.h"
 
 template <uint8_t packetSize = 32>
 class DataPacker2
@@ -38,7 +47,7 @@ public:
 		clear();
 	}
 
-	void clone(uint8_t * src, uint8_t srcOffset = 0, uint8_t len = packetSize) {
+	void clone(const uint8_t * src, uint8_t srcOffset = 0, uint8_t len = packetSize) {
 		if (len > packetSize)
 			len = packetSize;
 		memcpy(data, src + srcOffset, len);
@@ -62,20 +71,31 @@ public:
 		return data;
 	}
 
+	inline const uint8_t * getBuffer() const {
+		return data;
+	}
+
 	void clear() {
 		memset(data, 0, packetSize);
 		occupiedMembers = 0;
 		occupiedBytes = 0;
 	}
 
-	inline uint8_t size() {
+	inline uint8_t size() const {
 		return packetSize;
 	}
 
-	inline uint8_t length() {
+	inline uint8_t length() const {
 		return occupiedBytes;
 	}
 
+	/// mark the first 'length' bytes as occupied, for data written directly to the buffer
+	void setLength(uint8_t length) {
+		if (length > packetSize - 3)
+			length = packetSize - 3;
+		occupiedBytes = length;
+	}
+
 	/// push numbers / structs / classes to the end of packet, return index of newly added number
 	template<typename T>
 	int16_t push(T value) {
@@ -149,20 +169,29 @@ public:
 		for (uint8_t i = 0; i < index; ++i)
 			offset += map[i];
 
-		// this simple casting raises GCC warning: [-Wstrict-aliasing]
-		// return *(reinterpret_cast<T*>(&data[offset]));
+		// casting the pointer is undefined behaviour and faults on unaligned wide loads,
+		// memcpy is turned into a single load by the compiler
+		T value;
+		memcpy(&value, data + offset, sizeof(T));
+		return value;
+	}
 
-		union
-		{
-			uint8_t * buff;
-			T * val;
-		} temp;
-		temp.buff = data + offset;
-		return *(temp.val);
+	/// get field at the offset fixed by its schema
+	template<typename Field>
+	typename Field::type get() const {
+		static_assert(Field::end + 3 <= packetSize, "field does not fit in packet");
+		typename Field::type value;
+		memcpy(&value, data + Field::offset, sizeof(value));
+		return value;
+	}
 
-		/*T value;
-		memcpy(&value, data + offset, sizeof(T));
-		return value;*/
+	/// put field at the offset fixed by its schema
+	template<typename Field>
+	void put(const typename Field::type & value) {
+		static_assert(Field::end + 3 <= packetSize, "field does not fit in packet");
+		memcpy(data + Field::offset, &value, sizeof(value));
+		if (occupiedBytes < Field::end)
+			occupiedBytes = Field::end;
 	}
 
 	/// get char array and copy it to 'buffer'
@@ -188,13 +217,9 @@ public:
 
 	/// get CRC embedded in packet
 	uint16_t getCRC() {
-		union
-		{
-			uint8_t * buff;
-			uint16_t * val;
-		} temp;
-		temp.buff = data + (packetSize - 2);
-		return *(temp.val);
+		uint16_t crc;
+		memcpy(&crc, data + (packetSize - 2), 2);
+		return crc;
 	}
 
 	/// calculate CRC and then put it to the end of the packet
@@ -208,6 +233,42 @@ public:
 		return getCRC() == calcCRC();
 	}
 
+	/// largest frame writeFrame() can produce
+	static constexpr uint8_t maxFrameSize() {
+		return packetSize;
+	}
+
+	/// write occupied bytes as a variable-length frame to 'dest' (at least length() + 3 bytes)
+	/// return the frame size
+	uint8_t writeFrame(uint8_t * dest) const {
+		dest[0] = occupiedBytes;
+		memcpy(dest + 1, data, occupiedBytes);
+		const uint16_t crc = calculateCRC16(dest, occupiedBytes + 1);
+		memcpy(dest + 1 + occupiedBytes, &crc, 2);
+		return occupiedBytes + 3;
+	}
+
+	/// load a frame made by writeFrame(), return false if it is malformed or corrupted
+	bool readFrame(const uint8_t * src, const uint8_t size) {
+		if (size < 3)
+			return false;
+
+		const uint8_t frameLength = src[0];
+		if (frameLength > packetSize - 3 || frameLength + 3 != size)
+			return false;
+
+		uint16_t crc;
+		memcpy(&crc, src + 1 + frameLength, 2);
+		if (crc != calculateCRC16(src, frameLength + 1))
+			return false;
+
+		clear();
+		memcpy(data, src + 1, frameLength);
+		occupiedBytes = frameLength;
+		return true;
+	}
+
+	/// additive scrambling only, no secrecy or integrity: use UART_AEAD (LinkCipher.h) on the link
 	void cipher(uint8_t seed) {
 		if (cipherAlgorithm)
 			for (uint8_t i = 0; i < packetSize - 3; ++i) {
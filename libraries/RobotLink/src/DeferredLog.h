@@ -0,0 +1,233 @@
+#pragma once
+
+/*
+* ---DeferredLog---
+* Binary logging for LOG_DEFERRED builds: a log call stores a compact record
+* in a RAM ring instead of formatting text, LOG_DRAIN() sends the records
+* out from loop(), extras/logdecode.py turns them back into text on the PC.
+* Each drain hands over whole records only, so other output going through
+* the same pipe between two drains never splits a record.
+*
+* Record on the wire, little endian:
+*    [0xA5][length][level][format id: 2][millis: 4][arguments]
+*    length: bytes after the length byte
+*    format id: offset of the format string in the ELF section "logfmt"
+*
+* Arguments, in call order:
+*    integers up to 32 bits, pointers   4 bytes
+*    64-bit integers                    8 bytes
+*    float, double                      4 bytes (float)
+*    enums                              as their underlying integer
+*    strings, F() strings               [length][up to LOG_STRING_MAX chars]
+* Anything else (String, structs) does not compile, pass .c_str() or the fields.
+*
+* Records that do not fit in the ring are dropped and counted, the next
+* record that fits is preceded by a "dropped" record (format id 0xFFFF,
+* 4-byte count). Text from DUMP() still goes out as text, the
+* decoder passes everything outside records through.
+* ------------------
+*/
+
+#include "Arduino.h"
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+class __FlashStringHelper;
+
+#ifndef LOG_DEFERRED_BUFFER
+#define LOG_DEFERRED_BUFFER	512
+#endif
+
+// longest record, arguments that do not fit are cut off
+#ifndef LOG_RECORD_MAX
+#define LOG_RECORD_MAX		48
+#endif
+
+#ifndef LOG_STRING_MAX
+#define LOG_STRING_MAX		16
+#endif
+
+// bytes handed to the output per LOG_DRAIN(), at most
+#ifndef LOG_DRAIN_CHUNK
+#define LOG_DRAIN_CHUNK		64
+#endif
+
+static_assert(LOG_RECORD_MAX <= LOG_DRAIN_CHUNK, "a record must fit in one drain chunk");
+
+// format strings of deferred log calls, never read by the firmware
+extern "C" const char __start_logfmt[];
+
+#define LOG_FORMAT_ID(fmt)	({ \
+	static const char _log_format[] __attribute__((section("logfmt"), used)) = fmt; \
+	(uint16_t)(_log_format - __start_logfmt); })
+
+class DeferredLog
+{
+public:
+	static constexpr uint8_t sync = 0xA5;
+	static constexpr uint16_t dropped_id = 0xFFFF;
+
+	template <typename... Args>
+	void record(const uint8_t level, const uint16_t id, const Args &... args) {
+		uint8_t buffer[LOG_RECORD_MAX];
+		Writer writer(buffer);
+		writer.header(level, id, millis());
+		encode(writer, args...);
+		buffer[1] = writer.length() - 2;
+
+		if (m_dropped > 0) {
+			uint8_t note[LOG_RECORD_MAX];
+			Writer w(note);
+			w.header(level, dropped_id, millis());
+			w.put(m_dropped);
+			note[1] = w.length() - 2;
+			if (!push(note, w.length())) {
+				m_dropped++;
+				return;
+			}
+			m_dropped = 0;
+		}
+		if (!push(buffer, writer.length()))
+			m_dropped++;
+	}
+
+	/// send as many whole records as fit in LOG_DRAIN_CHUNK bytes to 'pipe' (Serial if null)
+	void drain(void(*pipe)(const char * buffer, const uint8_t length)) {
+		const uint16_t available = used();
+		uint8_t chunk[LOG_DRAIN_CHUNK];
+		uint8_t count = 0;
+		while (count < available) {
+			const uint8_t length = m_ring[(m_tail + count + 1) % LOG_DEFERRED_BUFFER] + 2;
+			if (count + length > LOG_DRAIN_CHUNK)
+				break;
+			// a record may wrap around the end of the ring
+			for (uint8_t i = 0; i < length; ++i)
+				chunk[count + i] = m_ring[(m_tail + count + i) % LOG_DEFERRED_BUFFER];
+			count += length;
+		}
+		if (count == 0)
+			return;
+
+		if (pipe)
+			pipe((const char *)chunk, count);
+		else
+			Serial.write(chunk, count);
+		m_tail = (m_tail + count) % LOG_DEFERRED_BUFFER;
+	}
+
+	/// records lost since the last "dropped" record went out
+	inline uint32_t dropped() const {
+		return m_dropped;
+	}
+
+private:
+	class Writer
+	{
+	public:
+		Writer(uint8_t * buffer)
+			: m_buffer(buffer) {
+		}
+
+		void header(const uint8_t level, const uint16_t id, const uint32_t ms) {
+			m_buffer[0] = sync;
+			m_length = 2;
+			put((uint8_t)level);
+			put(id);
+			put(ms);
+		}
+
+		template <typename T>
+		void put(const T value) {
+			if (m_length + sizeof(T) > LOG_RECORD_MAX)
+				return;
+			memcpy(m_buffer + m_length, &value, sizeof(T));
+			m_length += sizeof(T);
+		}
+
+		void putString(const char * text) {
+			if (m_length + 1 > LOG_RECORD_MAX)
+				return;
+			uint8_t length = text ? strnlen(text, LOG_STRING_MAX) : 0;
+			if (length > LOG_RECORD_MAX - m_length - 1)
+				length = LOG_RECORD_MAX - m_length - 1;
+			m_buffer[m_length++] = length;
+			memcpy(m_buffer + m_length, text, length);
+			m_length += length;
+		}
+
+		inline uint8_t length() const {
+			return m_length;
+		}
+
+	private:
+		uint8_t * const m_buffer;
+		uint8_t m_length{ 0 };
+	};
+
+	// argument types as printf sees them after promotion
+	static inline void encodeArg(Writer & w, const int v) { w.put((int32_t)v); }
+	static inline void encodeArg(Writer & w, const unsigned int v) { w.put((uint32_t)v); }
+	static inline void encodeArg(Writer & w, const long v) { w.put((int32_t)v); }
+	static inline void encodeArg(Writer & w, const unsigned long v) { w.put((uint32_t)v); }
+	static inline void encodeArg(Writer & w, const long long v) { w.put((int64_t)v); }
+	static inline void encodeArg(Writer & w, const unsigned long long v) { w.put((uint64_t)v); }
+	static inline void encodeArg(Writer & w, const bool v) { w.put((int32_t)v); }
+	static inline void encodeArg(Writer & w, const char v) { w.put((int32_t)v); }
+	static inline void encodeArg(Writer & w, const signed char v) { w.put((int32_t)v); }
+	static inline void encodeArg(Writer & w, const unsigned char v) { w.put((int32_t)v); }
+	static inline void encodeArg(Writer & w, const short v) { w.put((int32_t)v); }
+	static inline void encodeArg(Writer & w, const unsigned short v) { w.put((int32_t)v); }
+	static inline void encodeArg(Writer & w, const float v) { w.put(v); }
+	static inline void encodeArg(Writer & w, const double v) { w.put((float)v); }
+	static inline void encodeArg(Writer & w, const char * v) { w.putString(v); }
+	// flash is memory mapped on the STM32, F() strings read like any other
+	static inline void encodeArg(Writer & w, const __FlashStringHelper * v) { w.putString((const char *)v); }
+	static inline void encodeArg(Writer & w, const void * v) { w.put((uint32_t)(uintptr_t)v); }
+
+	// enum class does not promote to int like a plain enum, MessageType goes out as a uint8_t
+	template <typename T>
+	static inline typename std::enable_if<std::is_enum<T>::value>::type encodeArg(Writer & w, const T v) {
+		encodeArg(w, (typename std::underlying_type<T>::type)v);
+	}
+
+	template <typename T>
+	static inline typename std::enable_if<std::is_class<T>::value>::type encodeArg(Writer &, const T &) {
+		static_assert(!std::is_class<T>::value, "deferred log arguments are numbers, enums and C strings, pass .c_str() or the fields");
+	}
+
+	static inline void encode(Writer &) {
+	}
+
+	template <typename Head, typename... Rest>
+	static inline void encode(Writer & w, const Head & head, const Rest &... rest) {
+		encodeArg(w, head);
+		encode(w, rest...);
+	}
+
+	inline uint16_t used() const {
+		return (m_head + LOG_DEFERRED_BUFFER - m_tail) % LOG_DEFERRED_BUFFER;
+	}
+
+	/// whole record or nothing
+	bool push(const uint8_t * data, const uint8_t length) {
+		if (used() + length >= LOG_DEFERRED_BUFFER)
+			return false;
+		for (uint8_t i = 0; i < length; ++i) {
+			m_ring[m_head] = data[i];
+			m_head = (m_head + 1) % LOG_DEFERRED_BUFFER;
+		}
+		return true;
+	}
+
+	uint8_t m_ring[LOG_DEFERRED_BUFFER];
+	uint16_t m_head{ 0 };
+	uint16_t m_tail{ 0 };
+	uint32_t m_dropped{ 0 };
+};
+
+/// the one ring, only linked in when LOG_DEFERRED macros are used
+inline DeferredLog & deferredLog() {
+	static DeferredLog log;
+	return log;
+}
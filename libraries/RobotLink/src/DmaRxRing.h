@@ -0,0 +1,151 @@
+#pragma once
+
+/*
+* ---DmaRxRing---
+* Bookkeeping for a circular DMA receive buffer.
+* The DMA channel writes into the buffer and wraps around by itself, the only
+* thing we can read back is the number of transfers remaining (CNDTR).
+* Every time the line goes idle, the bytes written since the previous idle
+* event are recorded as one frame (offset + length inside the ring).
+*
+* An idle event read late may cut a packet that is still coming in: pop()
+* with the number of bytes used hands the rest back, it then starts the next
+* frame, or the next idle event's frame if none is queued yet.
+*
+* Does not touch any hardware, feed it with onIdle() from the real USART
+* or from a simulated DMA (write bytes to buffer(), then call onIdle()).
+*
+* Note: if more than bufferSize bytes arrive between two idle events, the
+* DMA overwrites unread data and there is no way to detect it here,
+* keep bufferSize comfortably larger than the longest burst.
+* ------------------
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+template <uint16_t bufferSize = 64, uint8_t maxFrames = 4>
+class DmaRxRing {
+public:
+    struct Frame {
+        uint16_t offset;
+        uint16_t length;
+    };
+
+    DmaRxRing() {
+        clear();
+    }
+
+    void clear() {
+        memset(m_buffer, 0, bufferSize);
+        m_tail = 0;
+        m_frame_head = 0;
+        m_frame_count = 0;
+        m_dropped_frames = 0;
+    }
+
+    /// memory the DMA channel writes into
+    inline uint8_t * buffer() {
+        return m_buffer;
+    }
+
+    inline uint16_t capacity() const {
+        return bufferSize;
+    }
+
+    /// call on idle line, dma_remaining is the channel's remaining transfer count
+    void onIdle(const uint16_t dma_remaining) {
+        const uint16_t head = (bufferSize - dma_remaining) % bufferSize;
+        const uint16_t length = (head + bufferSize - m_tail) % bufferSize;
+
+        if (length == 0)
+            return;
+
+        if (m_frame_count >= maxFrames) {
+            m_dropped_frames++;
+        }
+        else {
+            Frame & f = m_frames[(m_frame_head + m_frame_count) % maxFrames];
+            f.offset = m_tail;
+            f.length = length;
+            m_frame_count++;
+        }
+        m_tail = head;
+    }
+
+    inline bool available() const {
+        return m_frame_count > 0;
+    }
+
+    /// oldest received frame, only valid if available()
+    inline const Frame & peek() const {
+        return m_frames[m_frame_head];
+    }
+
+    void pop() {
+        if (m_frame_count == 0)
+            return;
+        m_frame_head = (m_frame_head + 1) % maxFrames;
+        m_frame_count--;
+    }
+
+    /// pop the oldest frame but keep its bytes from 'consumed' on, in front of what follows
+    void pop(const uint16_t consumed) {
+        if (m_frame_count == 0)
+            return;
+        const Frame & frame = m_frames[m_frame_head];
+        if (consumed >= frame.length) {
+            pop();
+            return;
+        }
+        const uint16_t offset = (frame.offset + consumed) % bufferSize;
+        const uint16_t rest = frame.length - consumed;
+        pop();
+        if (m_frame_count > 0) {
+            Frame & next = m_frames[m_frame_head];
+            next.offset = offset;
+            next.length += rest;
+        }
+        else {
+            // the next onIdle() measures from here
+            m_tail = offset;
+        }
+    }
+
+    /// byte at 'index' of the frame, wrapping around the end of the ring
+    inline uint8_t at(const Frame & frame, const uint16_t index) const {
+        return m_buffer[(frame.offset + index) % bufferSize];
+    }
+
+    /// pointer to the frame inside the ring, nullptr if the frame wraps around
+    const uint8_t * contiguous(const Frame & frame) const {
+        if (frame.offset + frame.length > bufferSize)
+            return nullptr;
+        return m_buffer + frame.offset;
+    }
+
+    /// copy 'length' bytes of the frame starting at 'index' into dest, handles wrapping
+    void copy(const Frame & frame, const uint16_t index, uint8_t * dest, uint16_t length) const {
+        if (index + length > frame.length)
+            length = index < frame.length ? frame.length - index : 0;
+
+        const uint16_t start = (frame.offset + index) % bufferSize;
+        const uint16_t first = (start + length > bufferSize) ? bufferSize - start : length;
+
+        memcpy(dest, m_buffer + start, first);
+        memcpy(dest + first, m_buffer, length - first);
+    }
+
+    inline uint16_t droppedFrames() const {
+        return m_dropped_frames;
+    }
+
+private:
+    uint8_t m_buffer[bufferSize];
+    uint16_t m_tail;
+
+    Frame m_frames[maxFrames];
+    uint8_t m_frame_head;
+    uint8_t m_frame_count;
+    uint16_t m_dropped_frames;
+};
@@ -0,0 +1,344 @@
+#pragma once
+
+/*
+* ---E32Module---
+* Configuration driver for the Ebyte E32 (SX1278) UART LoRa module.
+*
+* Modes, selected with the M0 / M1 pins:
+*    M1 M0
+*     0  0   normal, transparent UART <-> air
+*     1  1   sleep / configuration, UART fixed at 9600 8N1
+*
+* Configuration commands (sleep mode):
+*    C1 C1 C1            -> module answers its 6 parameter bytes
+*    C0 + 5 bytes        write and save to flash
+*    C2 + 5 bytes        write, lost at power-off (used for negotiated settings,
+*                        so a power cycle always brings back the flashed ones)
+*
+* Parameters: HEAD ADDH ADDL SPED CHAN OPTION
+*    SPED:   bit 7..6 UART parity, bit 5..3 UART baud, bit 2..0 air data rate
+*    OPTION: bit 7 fixed transmission, bit 6 IO drive, bit 5..3 wake-up time,
+*            bit 2 FEC, bit 1..0 TX power (0: max)
+*
+* Port is anything with begin(baud), write(), read(), available(), flush(),
+* a HardwareSerial on the robot, a pty-backed serial on a host.
+* Configuration re-opens the port (9600, then back), call AsyncUart::begin()
+* again afterwards so its DMA receive is set up again.
+*
+* readConfig() / writeConfig() / setAirRate() block for up to ~600 ms (mode
+* switches and answer timeouts), for setup() only. Once the watchdog runs, change
+* the air rate with startAirRate() and call run() from loop() until it stops
+* returning BUSY; keep the link off the port while busy().
+* ------------------
+*/
+
+#include "Arduino.h"
+#include <string.h>
+
+#ifndef E32_TIMEOUT_MS
+#define E32_TIMEOUT_MS 200
+#endif
+
+// the module takes a while to switch modes, without AUX just wait
+#ifndef E32_MODE_DELAY_MS
+#define E32_MODE_DELAY_MS 50
+#endif
+
+enum E32AirRate : uint8_t {
+    E32_AIR_300 = 0,
+    E32_AIR_1200 = 1,
+    E32_AIR_2400 = 2,
+    E32_AIR_4800 = 3,
+    E32_AIR_9600 = 4,
+    E32_AIR_19200 = 5
+};
+
+struct E32Config {
+    uint8_t head{ 0xC0 };
+    uint8_t addh{ 0 };
+    uint8_t addl{ 0 };
+    uint8_t sped{ 0x1A };       // 8N1, 9600, 2.4k
+    uint8_t chan{ 0x17 };       // 433 MHz
+    uint8_t option{ 0x44 };     // push-pull, 250ms wake-up, FEC on, max power
+
+    inline uint8_t airRate() const {
+        return sped & 0x07;
+    }
+
+    inline void setAirRate(const uint8_t rate) {
+        sped = (sped & ~0x07) | (rate & 0x07);
+    }
+
+    inline uint8_t uartBaud() const {
+        return (sped >> 3) & 0x07;
+    }
+
+    inline bool fec() const {
+        return option & 0x04;
+    }
+
+    inline void setFec(const bool on) {
+        option = on ? (option | 0x04) : (option & ~0x04);
+    }
+
+    inline uint8_t txPower() const {
+        return option & 0x03;
+    }
+
+    inline void setTxPower(const uint8_t power) {
+        option = (option & ~0x03) | (power & 0x03);
+    }
+
+    /// air data rate in bits per second
+    static uint32_t airRateBps(const uint8_t rate) {
+        static const uint16_t rates[] = { 300, 1200, 2400, 4800, 9600, 19200, 19200, 19200 };
+        return rates[rate & 0x07];
+    }
+
+    /// UART baud rate in bits per second
+    static uint32_t uartBps(const uint8_t baud) {
+        static const uint32_t rates[] = { 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200 };
+        return rates[baud & 0x07];
+    }
+};
+
+// read straight into the struct, in the module's byte order
+static_assert(sizeof(E32Config) == 6, "E32Config must match the module's 6 parameter bytes");
+
+template <typename Port>
+class E32Module {
+public:
+    /// 'baudrate': what the sketch runs the port at in normal mode
+    E32Module(Port * port, const uint8_t m0, const uint8_t m1, const uint32_t baudrate, const uint8_t aux = 255)
+        : m_port(port),
+        m_m0(m0),
+        m_m1(m1),
+        m_aux(aux),
+        m_baudrate(baudrate) {
+    }
+
+    void begin() {
+        pinMode(m_m0, OUTPUT);
+        pinMode(m_m1, OUTPUT);
+        if (m_aux != 255)
+            pinMode(m_aux, INPUT);
+        setMode(false);
+    }
+
+    bool readConfig(E32Config & config) {
+        enterConfig();
+        const uint8_t command[] = { 0xC1, 0xC1, 0xC1 };
+        m_port->write(command, sizeof(command));
+        const bool ok = receive(&config.head, 6) && (config.head == 0xC0 || config.head == 0xC2);
+        leaveConfig();
+        return ok;
+    }
+
+    /// 'save': keep it over power cycles (C0), otherwise until power-off (C2)
+    bool writeConfig(const E32Config & config, const bool save) {
+        enterConfig();
+        const uint8_t command[] = { (uint8_t)(save ? 0xC0 : 0xC2),
+            config.addh, config.addl, config.sped, config.chan, config.option };
+        m_port->write(command, sizeof(command));
+
+        // the module echoes the parameters it accepted
+        uint8_t echo[6];
+        const bool ok = receive(echo, sizeof(echo)) && memcmp(echo + 1, command + 1, 5) == 0;
+        leaveConfig();
+        return ok;
+    }
+
+    /// change only the air data rate, leave every other parameter as it is
+    bool setAirRate(const uint8_t rate, const bool save = false) {
+        E32Config config;
+        if (!readConfig(config))
+            return false;
+        if (config.airRate() == rate)
+            return true;
+        config.setAirRate(rate);
+        return writeConfig(config, save);
+    }
+
+    enum class Job : uint8_t {
+        IDLE,       // nothing started
+        BUSY,       // module in configuration mode, port at 9600
+        DONE,       // back in normal mode with the new rate
+        FAILED      // back in normal mode, rate unknown
+    };
+
+    /// setAirRate() without blocking: starts it, run() does the rest,
+    /// false if a change is already running
+    bool startAirRate(const uint8_t rate, const bool save = false) {
+        if (busy())
+            return false;
+        m_job_rate = rate;
+        m_job_save = save;
+        m_port->flush();
+        setPins(true);
+        step(Step::ENTER);
+        return true;
+    }
+
+    /// advance a started change, never waits: BUSY until it ends, then DONE or FAILED once
+    Job run() {
+        const uint32_t now = millis();
+        switch (m_step) {
+        case Step::IDLE:
+            return Job::IDLE;
+        case Step::ENTER:
+            if (modeReady(now)) {
+                m_port->begin(9600);
+                while (m_port->available() > 0)
+                    m_port->read();
+                const uint8_t command[] = { 0xC1, 0xC1, 0xC1 };
+                m_port->write(command, sizeof(command));
+                step(Step::READ);
+            }
+            return Job::BUSY;
+        case Step::READ:
+        case Step::WRITE:
+            while (m_received < sizeof(m_answer) && m_port->available() > 0)
+                m_answer[m_received++] = m_port->read();
+            if (m_received < sizeof(m_answer)) {
+                if (now - m_step_ms >= E32_TIMEOUT_MS)
+                    leave(false);
+            }
+            else if (m_step == Step::READ)
+                configRead();
+            else
+                // the module echoes the parameters it accepted
+                leave(memcmp(m_answer + 1, m_command + 1, 5) == 0);
+            return Job::BUSY;
+        case Step::LEAVE:
+            if (!modeReady(now))
+                return Job::BUSY;
+            m_step = Step::IDLE;
+            return m_job_ok ? Job::DONE : Job::FAILED;
+        }
+        return Job::IDLE;
+    }
+
+    /// a startAirRate() is running, the port belongs to the module
+    inline bool busy() const {
+        return m_step != Step::IDLE;
+    }
+
+private:
+    enum class Step : uint8_t {
+        IDLE,
+        ENTER,      // waiting for configuration mode
+        READ,       // waiting for the 6 parameter bytes
+        WRITE,      // waiting for the echo of the new ones
+        LEAVE       // waiting for normal mode
+    };
+
+    void setPins(const bool configuration) {
+        digitalWrite(m_m0, configuration ? HIGH : LOW);
+        digitalWrite(m_m1, configuration ? HIGH : LOW);
+    }
+
+    void setMode(const bool configuration) {
+        setPins(configuration);
+        waitReady();
+    }
+
+    void step(const Step next) {
+        m_step = next;
+        m_step_ms = millis();
+        m_aux_low_ms = m_step_ms;
+        m_received = 0;
+    }
+
+    /// the parameters came in: done if the rate is already set, otherwise write it
+    void configRead() {
+        E32Config config;
+        memcpy(&config.head, m_answer, sizeof(m_answer));
+        if (config.head != 0xC0 && config.head != 0xC2) {
+            leave(false);
+            return;
+        }
+        if (config.airRate() == m_job_rate) {
+            leave(true);
+            return;
+        }
+        config.setAirRate(m_job_rate);
+        m_command[0] = m_job_save ? 0xC0 : 0xC2;
+        m_command[1] = config.addh;
+        m_command[2] = config.addl;
+        m_command[3] = config.sped;
+        m_command[4] = config.chan;
+        m_command[5] = config.option;
+        m_port->write(m_command, sizeof(m_command));
+        step(Step::WRITE);
+    }
+
+    void leave(const bool ok) {
+        m_job_ok = ok;
+        m_port->flush();
+        m_port->begin(m_baudrate);
+        setPins(false);
+        step(Step::LEAVE);
+    }
+
+    /// waitReady() as a check: mode delay over, or AUX high for 2 ms (or timed out)
+    bool modeReady(const uint32_t now) {
+        if (m_aux == 255)
+            return now - m_step_ms >= E32_MODE_DELAY_MS;
+        if (digitalRead(m_aux) == LOW && now - m_step_ms < E32_TIMEOUT_MS) {
+            m_aux_low_ms = now;
+            return false;
+        }
+        return now - m_aux_low_ms >= 2;
+    }
+
+    void enterConfig() {
+        m_port->flush();
+        setMode(true);
+        m_port->begin(9600);
+        while (m_port->available() > 0)
+            m_port->read();
+    }
+
+    void leaveConfig() {
+        m_port->flush();
+        m_port->begin(m_baudrate);
+        setMode(false);
+    }
+
+    void waitReady() {
+        if (m_aux == 255) {
+            delay(E32_MODE_DELAY_MS);
+            return;
+        }
+        // AUX goes high when the module is idle, it still needs ~2ms after that
+        const uint32_t start = millis();
+        while (digitalRead(m_aux) == LOW && millis() - start < E32_TIMEOUT_MS);
+        delay(2);
+    }
+
+    bool receive(uint8_t * dest, const uint8_t length) {
+        const uint32_t start = millis();
+        uint8_t received = 0;
+        while (received < length && millis() - start < E32_TIMEOUT_MS) {
+            if (m_port->available() > 0)
+                dest[received++] = m_port->read();
+        }
+        return received == length;
+    }
+
+    Port * const m_port;
+    const uint8_t m_m0;
+    const uint8_t m_m1;
+    const uint8_t m_aux;
+    const uint32_t m_baudrate;
+
+    Step m_step{ Step::IDLE };
+    uint32_t m_step_ms{ 0 };
+    uint32_t m_aux_low_ms{ 0 };
+    uint8_t m_answer[6];
+    uint8_t m_received{ 0 };
+    uint8_t m_command[6];
+    uint8_t m_job_rate{ 0 };
+    bool m_job_save{ false };
+    bool m_job_ok{ false };
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+/*
+* ---FrameParser---
+* Self-synchronizing framing for byte streams.
+*
+* Frame structure:
+*    sync word  +  length  +  payload  +  CRC16
+*     2 bytes   +  1 byte  +  n bytes  +  2 bytes
+*
+* CRC-16/MODBUS covers length and payload, it is updated as bytes are parsed.
+* The parser is fed one byte at a time. When a candidate frame turns out to
+* be bad (length out of range or CRC mismatch), the bytes after its sync word
+* are scanned again, so a real frame hidden inside garbage is still found
+* and the stream is back in sync within one frame.
+* ------------------
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "crc16.h"
+
+constexpr uint8_t FRAME_SYNC_0 = 0xAA;
+constexpr uint8_t FRAME_SYNC_1 = 0x55;
+constexpr uint8_t FRAME_HEADER_SIZE = 3;
+constexpr uint8_t FRAME_OVERHEAD = FRAME_HEADER_SIZE + 2;
+
+/// write a complete frame to 'dest' (at least length + FRAME_OVERHEAD bytes), return frame size
+static inline uint8_t encodeFrame(const uint8_t * payload, const uint8_t length, uint8_t * dest) {
+    dest[0] = FRAME_SYNC_0;
+    dest[1] = FRAME_SYNC_1;
+    dest[2] = length;
+    memcpy(dest + FRAME_HEADER_SIZE, payload, length);
+
+    Crc16 crc;
+    crc.update(dest + 2, length + 1);
+    dest[FRAME_HEADER_SIZE + length] = crc.value() & 0xFF;
+    dest[FRAME_HEADER_SIZE + length + 1] = crc.value() >> 8;
+    return length + FRAME_OVERHEAD;
+}
+
+template <uint8_t maxPayload = 32>
+class FrameParser {
+public:
+    FrameParser() {
+        reset();
+    }
+
+    void reset() {
+        m_raw_length = 0;
+        m_parsed = 0;
+        m_frame_ready = false;
+    }
+
+    /// append a received byte, call next() afterwards to collect frames
+    void feed(const uint8_t byte) {
+        dropReadyFrame();
+
+        // cannot happen with a sane maxPayload, but never overflow
+        if (m_raw_length >= sizeof(m_raw))
+            resync();
+
+        m_raw[m_raw_length++] = byte;
+    }
+
+    /// parse what has been fed so far, return true when a valid frame is ready
+    bool next() {
+        dropReadyFrame();
+
+        while (m_parsed < m_raw_length) {
+            const uint8_t index = m_parsed++;
+            const uint8_t byte = m_raw[index];
+
+            if (index == 0) {
+                if (byte != FRAME_SYNC_0)
+                    resync();
+            }
+            else if (index == 1) {
+                if (byte != FRAME_SYNC_1)
+                    resync();
+            }
+            else if (index == 2) {
+                if (byte > maxPayload) {
+                    m_errors++;
+                    resync();
+                }
+                else {
+                    m_crc.reset();
+                    m_crc.update(byte);
+                }
+            }
+            else if (index < m_raw[2] + FRAME_HEADER_SIZE) {
+                m_crc.update(byte);
+            }
+            else if (index + 1 == m_raw[2] + FRAME_OVERHEAD) {
+                const uint16_t crc = m_raw[index - 1] | (m_raw[index] << 8);
+                if (crc == m_crc.value()) {
+                    m_frame_ready = true;
+                    m_frames++;
+                    return true;
+                }
+                m_errors++;
+                resync();
+            }
+        }
+        return false;
+    }
+
+    /// payload of the ready frame, valid until the next feed() / next()
+    inline const uint8_t * payload() const {
+        return m_raw + FRAME_HEADER_SIZE;
+    }
+
+    inline uint8_t length() const {
+        return m_raw[2];
+    }
+
+    /// frames dropped because of bad length or CRC
+    inline uint16_t errors() const {
+        return m_errors;
+    }
+
+    inline uint16_t frames() const {
+        return m_frames;
+    }
+
+private:
+    void dropReadyFrame() {
+        if (!m_frame_ready)
+            return;
+        m_frame_ready = false;
+        discard(m_raw[2] + FRAME_OVERHEAD);
+    }
+
+    // skip the current candidate's first byte and look for the next sync byte
+    void resync() {
+        uint8_t skip = 1;
+        while (skip < m_raw_length && m_raw[skip] != FRAME_SYNC_0)
+            skip++;
+        discard(skip);
+    }
+
+    void discard(uint8_t count) {
+        if (count > m_raw_length)
+            count = m_raw_length;
+        m_raw_length -= count;
+        memmove(m_raw, m_raw + count, m_raw_length);
+        m_parsed = 0;
+    }
+
+    uint8_t m_raw[maxPayload + FRAME_OVERHEAD];
+    uint8_t m_raw_length;
+    uint8_t m_parsed;
+    bool m_frame_ready;
+    Crc16 m_crc;
+
+    uint16_t m_errors{ 0 };
+    uint16_t m_frames{ 0 };
+};
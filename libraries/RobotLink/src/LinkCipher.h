@@ -0,0 +1,326 @@
+#pragma once
+
+/*
+* ---LinkCipher---
+* Authenticated encryption for short link packets:
+* ChaCha20 (RFC 7539) for confidentiality, HalfSipHash-2-4 as a 32-bit MAC,
+* a per-sender sequence number and a per-peer challenge against replays.
+* Everything is 32-bit arithmetic, one ChaCha20 block per packet.
+*
+* Sealed packet:
+*    address  +  sequence  + [challenge] +  ciphertext  +  tag
+*    1 byte   +  4 bytes   + [4 bytes]   +  n bytes     +  4 bytes
+*
+* The address byte (see LinkField) stays in clear so receivers can filter
+* on it, it is covered by the tag together with everything after it.
+*
+* Freshness without persistent storage: every node draws a random 32-bit
+* challenge per peer. A peer keys its packets with the challenge it last got
+* from us (its "echo"), so only packets made after we issued our current
+* challenge verify, anything recorded before a reboot or a renewal fails the
+* tag. Within one challenge the 31-bit sequence must increase.
+*
+* Per packet: block = ChaCha20(key, counter = carried challenge or 0,
+*                              nonce = sequence | sender | echo)
+*    block[0..7]   -> HalfSipHash key
+*    block[8..63]  -> keystream XOR-ed onto the payload (up to 56 bytes)
+*
+* Handshake: a sender that knows no challenge of the peer (after boot, or
+* nothing fresh came back for the resync time given to begin()) seals with echo 0 and
+* carries its own challenge (bit 31 of the sequence). The receiver does not
+* deliver such a packet: it renews its challenge for that peer, restarts the
+* sequence check and answers with any packet (open() returns 0, see
+* helloDue()), which carries the new challenge. The challenge is carried until
+* the peer has used it, so a steady link costs 8 bytes per packet.
+* A replayed handshake packet only forces a new handshake, it delivers nothing.
+* ------------------
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+// restart the handshake with a peer that sent nothing fresh for this long,
+// e.g. it rebooted and lost our challenge
+#ifndef LINK_CIPHER_RESYNC_MS
+#define LINK_CIPHER_RESYNC_MS 2000
+#endif
+
+static inline uint32_t cipherRotl(const uint32_t x, const uint8_t n) {
+	return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t cipherLoad32(const uint8_t * p) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void cipherStore32(uint8_t * p, const uint32_t v) {
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+#define CHACHA_QUARTER_ROUND(a, b, c, d) \
+	a += b; d ^= a; d = cipherRotl(d, 16); \
+	c += d; b ^= c; b = cipherRotl(b, 12); \
+	a += b; d ^= a; d = cipherRotl(d, 8); \
+	c += d; b ^= c; b = cipherRotl(b, 7);
+
+/// one 64-byte ChaCha20 keystream block
+static inline void chacha20Block(const uint32_t key[8], const uint32_t counter, const uint32_t nonce[3], uint8_t out[64]) {
+	uint32_t input[16] = {
+		0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+		key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+		counter, nonce[0], nonce[1], nonce[2]
+	};
+	uint32_t x[16];
+	memcpy(x, input, sizeof(x));
+
+	for (uint8_t i = 0; i < 10; ++i) {
+		CHACHA_QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+		CHACHA_QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+		CHACHA_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+		CHACHA_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+		CHACHA_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+		CHACHA_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+		CHACHA_QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+		CHACHA_QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+	}
+
+	for (uint8_t i = 0; i < 16; ++i)
+		cipherStore32(out + 4 * i, x[i] + input[i]);
+}
+
+#define HALFSIPHASH_ROUND(v0, v1, v2, v3) \
+	v0 += v1; v1 = cipherRotl(v1, 5); v1 ^= v0; v0 = cipherRotl(v0, 16); \
+	v2 += v3; v3 = cipherRotl(v3, 8); v3 ^= v2; \
+	v0 += v3; v3 = cipherRotl(v3, 7); v3 ^= v0; \
+	v2 += v1; v1 = cipherRotl(v1, 13); v1 ^= v2; v2 = cipherRotl(v2, 16);
+
+/// HalfSipHash-2-4 with 32-bit output
+static inline uint32_t halfSipHash24(const uint8_t key[8], const uint8_t * data, const uint8_t length) {
+	const uint32_t k0 = cipherLoad32(key);
+	const uint32_t k1 = cipherLoad32(key + 4);
+	uint32_t v0 = k0;
+	uint32_t v1 = k1;
+	uint32_t v2 = 0x6c796765 ^ k0;
+	uint32_t v3 = 0x74656462 ^ k1;
+
+	uint8_t i = 0;
+	for (; i + 4 <= length; i += 4) {
+		const uint32_t m = cipherLoad32(data + i);
+		v3 ^= m;
+		HALFSIPHASH_ROUND(v0, v1, v2, v3);
+		HALFSIPHASH_ROUND(v0, v1, v2, v3);
+		v0 ^= m;
+	}
+
+	uint32_t b = (uint32_t)length << 24;
+	for (uint8_t shift = 0; i < length; ++i, shift += 8)
+		b |= (uint32_t)data[i] << shift;
+
+	v3 ^= b;
+	HALFSIPHASH_ROUND(v0, v1, v2, v3);
+	HALFSIPHASH_ROUND(v0, v1, v2, v3);
+	v0 ^= b;
+	v2 ^= 0xff;
+	for (uint8_t r = 0; r < 4; ++r) {
+		HALFSIPHASH_ROUND(v0, v1, v2, v3);
+	}
+	return v1 ^ v3;
+}
+
+class LinkCipher {
+public:
+	/// bytes a sealed packet grows by at most, 4 less once the peer knows our challenge
+	static constexpr uint8_t overhead = 12;
+	/// longest payload (after the address byte) one block can cover
+	static constexpr uint8_t maxPayload = 56;
+
+	/// key: 32 bytes shared by every node, entropy: anything that differs between boots,
+	/// resync_ms: longer than the peer may normally stay silent
+	void begin(const uint8_t key[32], const uint32_t entropy, const uint32_t resync_ms = LINK_CIPHER_RESYNC_MS) {
+		m_resync_ms = resync_ms;
+		for (uint8_t i = 0; i < 8; ++i)
+			m_key[i] = cipherLoad32(key + 4 * i);
+		m_entropy = entropy;
+		m_random_count = 0;
+		memset(m_peers, 0, sizeof(m_peers));
+		for (uint8_t i = 0; i < 16; ++i)
+			renew(m_peers[i]);
+		m_tx_sequence = nextRandom() & sequence_mask;
+		m_hello_to = -1;
+	}
+
+	/// encrypt and authenticate buffer[1 .. length) in place, buffer[0] is the address byte
+	/// return sealed length, 0 if it does not fit in 'capacity'
+	uint8_t seal(uint8_t * buffer, const uint8_t length, const uint8_t capacity, const uint32_t current_ms) {
+		if (length < 1 || length - 1 > maxPayload)
+			return 0;
+
+		const uint8_t to = buffer[0] >> 4;
+		Peer & peer = m_peers[to];
+		if (peer.echo != 0 && current_ms - peer.heard_ms > m_resync_ms) {
+			// the peer may have rebooted: a new challenge keeps its previous boot out
+			peer.echo = 0;
+			renew(peer);
+		}
+		const bool carry = peer.echo == 0 || !peer.confirmed;
+		const uint8_t header = carry ? 9 : 5;
+		const uint8_t payload = length - 1;
+		if (header + payload + 4 > capacity)
+			return 0;
+
+		m_tx_sequence = (m_tx_sequence + 1) & sequence_mask;
+		const uint32_t sequence = m_tx_sequence | (carry ? challenge_flag : 0);
+		const uint32_t carried = carry ? peer.challenge : 0;
+
+		memmove(buffer + header, buffer + 1, payload);
+		cipherStore32(buffer + 1, sequence);
+		if (carry)
+			cipherStore32(buffer + 5, carried);
+
+		uint8_t block[64];
+		keyBlock(sequence, buffer[0] & 0x0F, peer.echo, carried, block);
+		for (uint8_t i = 0; i < payload; ++i)
+			buffer[header + i] ^= block[8 + i];
+
+		cipherStore32(buffer + header + payload, halfSipHash24(block, buffer, header + payload));
+		if (m_hello_to == to)
+			m_hello_to = -1;
+		return header + payload + 4;
+	}
+
+	/// verify and decrypt in place, the payload moves back right after the address byte
+	/// return plain length (address + payload), 0 for a handshake (nothing to deliver,
+	/// answer it, see helloDue()), -1 if forged, corrupted, stale or replayed
+	int16_t open(uint8_t * buffer, const uint8_t length, const uint32_t current_ms) {
+		if (length < 1 + 4 + 4) {
+			m_auth_failures++;
+			return -1;
+		}
+
+		const uint8_t sender = buffer[0] & 0x0F;
+		const uint32_t sequence = cipherLoad32(buffer + 1);
+		const bool carry = sequence & challenge_flag;
+		const uint8_t header = carry ? 9 : 5;
+		if (length < header + 4 || length - header - 4 > maxPayload) {
+			m_auth_failures++;
+			return -1;
+		}
+		const uint8_t payload = length - header - 4;
+		const uint32_t carried = carry ? cipherLoad32(buffer + 5) : 0;
+
+		Peer & peer = m_peers[sender];
+		uint8_t block[64];
+		keyBlock(sequence, sender, peer.challenge, carried, block);
+		if (!tagMatches(block, buffer, header + payload)) {
+			// not keyed with our current challenge: a handshake, or forged / recorded earlier
+			keyBlock(sequence, sender, 0, carried, block);
+			if (!carry || carried == 0 || !tagMatches(block, buffer, header + payload)) {
+				m_auth_failures++;
+				return -1;
+			}
+			peer.echo = carried;
+			peer.heard_ms = current_ms;
+			renew(peer);
+			m_hello_to = sender;
+			m_handshakes++;
+			return 0;
+		}
+
+		const uint32_t counter = sequence & sequence_mask;
+		if (peer.sequence_valid && !newer(counter, peer.sequence)) {
+			m_replays++;
+			return -1;
+		}
+		peer.sequence_valid = true;
+		peer.sequence = counter;
+		peer.confirmed = true;
+		peer.heard_ms = current_ms;
+		if (carry)
+			peer.echo = carried;
+
+		for (uint8_t i = 0; i < payload; ++i)
+			buffer[1 + i] = buffer[header + i] ^ block[8 + i];
+		return 1 + payload;
+	}
+
+	/// address of a peer whose handshake still needs an answer, -1 if none:
+	/// seal any packet to it, even one without payload
+	inline int8_t helloDue() const {
+		return m_hello_to;
+	}
+
+	inline uint16_t authFailures() const {
+		return m_auth_failures;
+	}
+
+	inline uint16_t replays() const {
+		return m_replays;
+	}
+
+	/// handshakes answered, one per peer boot / resync on a healthy link
+	inline uint16_t handshakes() const {
+		return m_handshakes;
+	}
+
+private:
+	static constexpr uint32_t challenge_flag = 0x80000000;
+	static constexpr uint32_t sequence_mask = 0x7FFFFFFF;
+
+	struct Peer {
+		uint32_t challenge;     // ours, the peer keys its packets to us with it
+		uint32_t echo;          // the peer's challenge for us, 0: unknown
+		uint32_t sequence;      // last accepted under 'challenge'
+		uint32_t heard_ms;      // last packet from the peer that verified
+		bool sequence_valid;
+		bool confirmed;         // the peer used 'challenge', no need to carry it
+	};
+
+	/// 'a' follows 'b' in the 31-bit sequence space
+	static inline bool newer(const uint32_t a, const uint32_t b) {
+		const uint32_t ahead = (a - b) & sequence_mask;
+		return ahead != 0 && ahead < (sequence_mask >> 1);
+	}
+
+	void keyBlock(const uint32_t sequence, const uint8_t sender, const uint32_t echo, const uint32_t carried,
+		uint8_t block[64]) const {
+		const uint32_t nonce[3] = { sequence, sender, echo };
+		chacha20Block(m_key, carried, nonce, block);
+	}
+
+	static bool tagMatches(const uint8_t block[64], const uint8_t * buffer, const uint8_t length) {
+		return halfSipHash24(block, buffer, length) == cipherLoad32(buffer + length);
+	}
+
+	/// keystream of (key, counter 0, nonce = entropy | count | 0), never used by a packet:
+	/// those have a non-zero counter (carried challenge) or a non-zero echo
+	uint32_t nextRandom() {
+		const uint32_t nonce[3] = { m_entropy, ++m_random_count, 0 };
+		uint8_t block[64];
+		chacha20Block(m_key, 0, nonce, block);
+		return cipherLoad32(block);
+	}
+
+	/// new challenge for 'peer', sequences seen so far no longer count
+	void renew(Peer & peer) {
+		do
+			peer.challenge = nextRandom();
+		while (peer.challenge == 0);
+		peer.confirmed = false;
+		peer.sequence_valid = false;
+	}
+
+	uint32_t m_key[8];
+	uint32_t m_entropy{ 0 };
+	uint32_t m_random_count{ 0 };
+	uint32_t m_tx_sequence{ 0 };
+	uint32_t m_resync_ms{ LINK_CIPHER_RESYNC_MS };
+	Peer m_peers[16];
+	int8_t m_hello_to{ -1 };
+
+	uint16_t m_auth_failures{ 0 };
+	uint16_t m_replays{ 0 };
+	uint16_t m_handshakes{ 0 };
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+/*
+* ---LinkStats---
+* Link quality from a small header carried by every packet:
+*    sequence  +  stamp  +  echo
+*    1 byte    +  2      +  2      (ms, little endian, wrap every 65 s)
+*
+* stamp: sender's clock when the packet left
+* echo:  the last stamp heard from the peer, advanced by how long it was held,
+*        so the original sender gets RTT = now - echo with no clock sync
+*
+* From that, over a sliding window of LINK_STATS_BUCKETS x LINK_STATS_BUCKET_MS:
+*    loss %    sequence gaps / expected packets
+*    error %   rejected frames (CRC, auth) / frames that arrived
+*    RTT       average and max
+*    jitter    RFC 3550 interarrival jitter, smoothed over the whole run
+*
+* No hardware access, AsyncUart calls stamp() / receive() / onError().
+* ------------------
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef LINK_STATS_BUCKETS
+#define LINK_STATS_BUCKETS 8
+#endif
+
+#ifndef LINK_STATS_BUCKET_MS
+#define LINK_STATS_BUCKET_MS 250
+#endif
+
+struct LinkQuality {
+    uint16_t received;
+    uint16_t lost;
+    uint16_t errors;
+    uint8_t loss_percent;
+    uint8_t error_percent;
+    uint16_t rtt_ms;        // average, 0 if no sample in the window
+    uint16_t rtt_max_ms;
+    uint16_t jitter_ms;
+};
+
+class LinkStats {
+public:
+    static constexpr uint8_t headerSize = 5;
+
+    LinkStats() {
+        clear();
+    }
+
+    void clear() {
+        memset(m_buckets, 0, sizeof(m_buckets));
+        m_bucket_time = 0;
+        m_has_peer = false;
+        m_jitter_x16 = 0;
+    }
+
+    /// write the header for an outgoing packet to 'dest'
+    void stamp(uint8_t * dest, const uint32_t now_ms) {
+        uint16_t echo = no_echo;
+        // a stamp held for too long would wrap
+        if (m_has_peer && now_ms - m_peer_rx_ms < 30000) {
+            echo = m_peer_stamp + (uint16_t)(now_ms - m_peer_rx_ms);
+            // keep the marker unambiguous, 1 ms off once every 65 s
+            if (echo == no_echo)
+                echo--;
+        }
+        dest[0] = m_tx_sequence++;
+        store16(dest + 1, (uint16_t)now_ms);
+        store16(dest + 3, echo);
+    }
+
+    /// account for the header of a packet that passed CRC / authentication
+    void receive(const uint8_t * src, const uint32_t now_ms) {
+        Bucket & bucket = advance(now_ms);
+        const uint8_t sequence = src[0];
+        const uint16_t stamp = load16(src + 1);
+        const uint16_t echo = load16(src + 3);
+
+        if (m_has_peer) {
+            const uint8_t gap = sequence - m_peer_sequence;
+            if (gap == 0)
+                return; // duplicate
+            // a big jump is a peer reboot or reordering, not 128+ losses
+            if (gap < 128)
+                bucket.lost += gap - 1;
+
+            // transit time difference, clock offset cancels out
+            const int16_t d = (int16_t)((uint16_t)((uint16_t)now_ms - stamp)
+                - (uint16_t)((uint16_t)m_peer_rx_ms - m_peer_stamp));
+            const uint16_t delta = d < 0 ? -d : d;
+            m_jitter_x16 += delta - ((m_jitter_x16 + 8) >> 4);
+        }
+        bucket.received++;
+
+        if (echo != no_echo) {
+            const uint16_t rtt = (uint16_t)now_ms - echo;
+            bucket.rtt_sum += rtt;
+            bucket.rtt_count++;
+            if (rtt > bucket.rtt_max)
+                bucket.rtt_max = rtt;
+        }
+
+        // unwrap the 16-bit stamp, packets are never 32 s apart while connected
+        if (m_has_peer)
+            m_peer_time += (int16_t)(stamp - m_peer_stamp);
+        else
+            m_peer_time = stamp;
+
+        m_has_peer = true;
+        m_peer_sequence = sequence;
+        m_peer_stamp = stamp;
+        m_peer_rx_ms = now_ms;
+    }
+
+    /// a frame arrived but was rejected
+    void onError(const uint32_t now_ms) {
+        advance(now_ms).errors++;
+    }
+
+    /// sender's clock when the last packet left, in ms (arbitrary origin)
+    inline uint32_t peerTime() const {
+        return m_peer_time;
+    }
+
+    LinkQuality quality(const uint32_t now_ms) {
+        advance(now_ms);
+
+        LinkQuality q;
+        memset(&q, 0, sizeof(q));
+        uint32_t rtt_sum = 0;
+        uint16_t rtt_count = 0;
+        for (uint8_t i = 0; i < LINK_STATS_BUCKETS; ++i) {
+            const Bucket & b = m_buckets[i];
+            q.received += b.received;
+            q.lost += b.lost;
+            q.errors += b.errors;
+            rtt_sum += b.rtt_sum;
+            rtt_count += b.rtt_count;
+            if (b.rtt_max > q.rtt_max_ms)
+                q.rtt_max_ms = b.rtt_max;
+        }
+
+        if (q.received + q.lost > 0)
+            q.loss_percent = (uint32_t)q.lost * 100 / (q.received + q.lost);
+        if (q.received + q.errors > 0)
+            q.error_percent = (uint32_t)q.errors * 100 / (q.received + q.errors);
+        if (rtt_count > 0)
+            q.rtt_ms = rtt_sum / rtt_count;
+        q.jitter_ms = (m_jitter_x16 + 8) >> 4;
+        return q;
+    }
+
+private:
+    static constexpr uint16_t no_echo = 0xFFFF;
+
+    struct Bucket {
+        uint16_t received;
+        uint16_t lost;
+        uint16_t errors;
+        uint16_t rtt_count;
+        uint32_t rtt_sum;
+        uint16_t rtt_max;
+    };
+
+    /// rotate the window up to 'now_ms', return the current bucket
+    Bucket & advance(const uint32_t now_ms) {
+        const uint32_t time = now_ms / LINK_STATS_BUCKET_MS;
+        uint32_t elapsed = time - m_bucket_time;
+        if (elapsed > LINK_STATS_BUCKETS)
+            elapsed = LINK_STATS_BUCKETS;
+        for (uint32_t i = 1; i <= elapsed; ++i)
+            memset(&m_buckets[(m_bucket_time + i) % LINK_STATS_BUCKETS], 0, sizeof(Bucket));
+        m_bucket_time = time;
+        return m_buckets[time % LINK_STATS_BUCKETS];
+    }
+
+    static inline void store16(uint8_t * p, const uint16_t v) {
+        p[0] = v;
+        p[1] = v >> 8;
+    }
+
+    static inline uint16_t load16(const uint8_t * p) {
+        return p[0] | (p[1] << 8);
+    }
+
+    Bucket m_buckets[LINK_STATS_BUCKETS];
+    uint32_t m_bucket_time;
+
+    uint8_t m_tx_sequence{ 0 };
+
+    bool m_has_peer;
+    uint8_t m_peer_sequence{ 0 };
+    uint16_t m_peer_stamp{ 0 };
+    uint32_t m_peer_rx_ms{ 0 };
+    uint32_t m_peer_time{ 0 };
+
+    uint32_t m_jitter_x16;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+/*
+* ---LogPipe---
+* Non-blocking log output: Logger hands finished lines to push() (it has the
+* flushPipe signature) and returns at once, drain() passes them on to the
+* real output a USB packet at a time, from loop() or any other single context.
+*
+*    LogPipe<1024> log_pipe;
+*    void logToPipe(const char * buffer, const uint8_t length) { log_pipe.push(buffer, length); }
+*
+*    setup():  logger.flushPipe = logToPipe;
+*    loop():   log_pipe.drain();               // or drain(sink), same signature as flushPipe
+*
+* Single producer (the context that logs), single consumer (the one that
+* drains): each index is written by one side only, no locks, no interrupts
+* disabled. A line that does not fit is dropped whole and counted, the next
+* line that fits is preceded by a note saying how many went missing.
+* ------------------
+*/
+
+#include "Arduino.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// bytes per drain() call, one full-speed USB bulk packet
+#ifndef LOG_PIPE_CHUNK
+#define LOG_PIPE_CHUNK	64
+#endif
+
+template <uint16_t bufferSize = 1024>
+class LogPipe
+{
+public:
+	typedef void(*Sink)(const char * buffer, const uint8_t length);
+
+	/// producer side, false if the line was dropped
+	bool push(const char * buffer, const uint8_t length) {
+		if (m_dropped_pending > 0) {
+			char note[40];
+			const int n = snprintf(note, sizeof(note), "-- %lu log lines dropped --\r\n", (unsigned long)m_dropped_pending);
+			if (!write(note, n)) {
+				drop();
+				return false;
+			}
+			m_dropped_pending = 0;
+		}
+		if (!write(buffer, length)) {
+			drop();
+			return false;
+		}
+		return true;
+	}
+
+	/// consumer side, hand at most LOG_PIPE_CHUNK contiguous bytes to 'sink'
+	/// (USB serial if null and a host is listening), return bytes handed over
+	uint16_t drain(Sink sink = nullptr) {
+		if (sink == nullptr && !Serial)
+			return 0;
+
+		const uint16_t head = m_head;
+		__asm__ volatile("" ::: "memory");
+		const uint16_t tail = m_tail;
+		if (head == tail)
+			return 0;
+
+		uint16_t count = head > tail ? head - tail : bufferSize - tail;
+		if (count > LOG_PIPE_CHUNK)
+			count = LOG_PIPE_CHUNK;
+
+		if (sink)
+			sink((const char *)m_buffer + tail, count);
+		else
+			Serial.write(m_buffer + tail, count);
+
+		__asm__ volatile("" ::: "memory");
+		m_tail = (tail + count) % bufferSize;
+		return count;
+	}
+
+	/// lines dropped since boot
+	inline uint32_t dropped() const {
+		return m_dropped;
+	}
+
+	/// bytes waiting to be drained
+	inline uint16_t used() const {
+		return (m_head + bufferSize - m_tail) % bufferSize;
+	}
+
+private:
+	bool write(const char * data, const uint16_t length) {
+		const uint16_t head = m_head;
+		const uint16_t tail = m_tail;
+		const uint16_t space = (tail + bufferSize - head - 1) % bufferSize;
+		if (length > space)
+			return false;
+
+		const uint16_t first = length < bufferSize - head ? length : bufferSize - head;
+		memcpy(m_buffer + head, data, first);
+		memcpy(m_buffer, data + first, length - first);
+
+		// data before index, the consumer may read it as soon as it sees the new head
+		__asm__ volatile("" ::: "memory");
+		m_head = (head + length) % bufferSize;
+		return true;
+	}
+
+	void drop() {
+		m_dropped++;
+		m_dropped_pending++;
+	}
+
+	uint8_t m_buffer[bufferSize];
+	volatile uint16_t m_head{ 0 };
+	volatile uint16_t m_tail{ 0 };
+	uint32_t m_dropped{ 0 };
+	uint32_t m_dropped_pending{ 0 };
+};
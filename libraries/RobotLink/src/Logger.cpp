@@ -61,14 +61,13 @@ Logger & Logger::begin(const LogLevels level) {
 	isEnded = false;
 	currentIndex = 0;
 
-	uint32_t currentMs = millis();
-	uint32_t currentSec = currentMs / 1000;
+	const uint32_t currentMs = millis();
+	const uint32_t currentSec = currentMs / 1000;
 
-	uint32_t dd = currentSec / 86400;
-	uint32_t hh = (currentSec - dd * 86400) / 3600;
-	uint32_t mm = (currentSec - dd * 86400 - hh * 3600) / 60;
-	uint32_t ss = currentSec % 60;
-	uint32_t ms = (currentMs - currentSec * 1000) / 10;
+	const uint32_t hh = currentSec / 3600 % 24;
+	const uint32_t mm = currentSec / 60 % 60;
+	const uint32_t ss = currentSec % 60;
+	const uint32_t ms = currentMs % 1000 / 10;
 
 	char type = '?';
 
@@ -90,8 +89,7 @@ Logger & Logger::begin(const LogLevels level) {
 		break;
 	}
 
-	//printf(F("[%d-%02d:%02d:%02d.%02d] -%c: "), dd, hh, mm, ss, ms, type);
-	printf(F("[%02lu:%02lu:%02lu.%02lu] -%c: "), hh, mm, ss, ms, type);
+	printf(F("[%02lu:%02lu:%02lu.%02lu] -%c: "), (unsigned long)hh, (unsigned long)mm, (unsigned long)ss, (unsigned long)ms, type);
 
 	return *this;
 }
@@ -202,12 +200,14 @@ Logger & Logger::error() {
 }
 
 void Logger::end() {
+	// nothing begun, or begun below the log level
+	if (isEnded)
+		return;
 	write('\r');
 	write('\n');
 	write('\0');
 	isEnded = true;
-	if (currentLevel >= setLevel)
-		flush();
+	flush();
 }
 
 Logger logger;
\ No newline at end of file
@@ -0,0 +1,287 @@
+#pragma once
+
+#include "Arduino.h"
+#include <stdarg.h>
+
+//#define LOGGER
+
+// log calls store binary records (format id + raw arguments), see DeferredLog.h,
+// call LOG_DRAIN() from loop(), decode on the PC with extras/logdecode.py
+//#define LOG_DEFERRED
+#define TRACE_LINE_ONLY				1
+#define TRACE_FUNC_ONLY				2
+#define TRACE_PRETTY_FUNC_ONLY		3
+#define TRACE_LINE_AND_FUNC			4
+#define TRACE_LINE_AND_PRETTY_FUNC	5
+
+
+// compile-time floor: calls below it are removed together with their arguments,
+// setLogLevel() can only raise the level further at runtime
+//#define LOG_MIN_LEVEL	LOG_LEVEL_INFO
+#define LOG_LEVEL_VERBOSE	0
+#define LOG_LEVEL_DEBUG		1
+#define LOG_LEVEL_INFO		2
+#define LOG_LEVEL_WARN		3
+#define LOG_LEVEL_ERROR		4
+#define LOG_LEVEL_NONE		5
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL	LOG_LEVEL_VERBOSE
+#endif
+
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE	256
+#endif
+
+#ifdef LOGGER
+
+#ifdef LOG_ENABLE_TRACE
+
+#if LOG_ENABLE_TRACE == TRACE_LINE_ONLY
+static const __FlashStringHelper * logFormat = F("(%d) ");
+#define __TRACE			.printf(logFormat, __LINE__)
+
+#elif LOG_ENABLE_TRACE == TRACE_FUNC_ONLY
+static const __FlashStringHelper * logFormat = F("(%s) ");
+#define __TRACE			.printf(logFormat, __FUNCTION__)
+
+#elif LOG_ENABLE_TRACE == TRACE_PRETTY_FUNC_ONLY
+static const __FlashStringHelper * logFormat = F("(%s) ");
+#define __TRACE			.printf(logFormat, __PRETTY_FUNCTION__)
+
+#elif LOG_ENABLE_TRACE == TRACE_LINE_AND_FUNC
+static const __FlashStringHelper * logFormat = F("(%d, %s) ");
+#define __TRACE			.printf(logFormat, __LINE__, __FUNCTION__)
+
+#elif LOG_ENABLE_TRACE == TRACE_LINE_AND_PRETTY_FUNC
+static const __FlashStringHelper * logFormat = F("(%d, %s) ");
+#define __TRACE			.printf(logFormat, __LINE__, __PRETTY_FUNCTION__)
+
+#endif
+
+#else
+#define __TRACE
+#endif
+
+#define END						end()
+
+// never called, lets the compiler check each log format against its arguments
+static inline void logCheckFormat(const char *, ...) __attribute__((format(printf, 1, 2)));
+static inline void logCheckFormat(const char *, ...) {
+}
+
+#define LOG_CHECK(fmt, ...)		do { if (0) logCheckFormat(fmt, ##__VA_ARGS__); } while (0)
+
+#ifdef LOG_DEFERRED
+#include "DeferredLog.h"
+
+#define LOG_AT(level, fmt, ...)	do { LOG_CHECK(fmt, ##__VA_ARGS__); if ((level) >= logger.logLevel()) \
+	deferredLog().record((level), LOG_FORMAT_ID(fmt), ##__VA_ARGS__); } while (0)
+
+#define LOG_REPEATED(level, count, span, fmt, ...)	do { if ((count) > 1) \
+	deferredLog().record((level), LOG_FORMAT_ID(fmt LOG_REPEAT_FORMAT), ##__VA_ARGS__, (unsigned int)(count), (unsigned long)(span)); \
+	else deferredLog().record((level), LOG_FORMAT_ID(fmt), ##__VA_ARGS__); } while (0)
+
+#define LOG_DRAIN()				deferredLog().drain(logger.flushPipe)
+#else
+// level checked before begin(), a rejected call costs one compare
+#define LOG_AT(level, fmt, ...)	do { LOG_CHECK(fmt, ##__VA_ARGS__); if ((level) >= logger.logLevel()) \
+	logger.begin(level)__TRACE.printf(F(fmt), ##__VA_ARGS__).END; } while (0)
+
+#define LOG_REPEATED(level, count, span, fmt, ...)	do { logger.begin(level)__TRACE.printf(F(fmt), ##__VA_ARGS__); \
+	if ((count) > 1) logger.printf(F(LOG_REPEAT_FORMAT), (unsigned int)(count), (unsigned long)(span)); \
+	logger.END; } while (0)
+
+#define LOG_DRAIN()
+#endif
+
+// at most one line per 'period' ms from this call site, the calls held back in
+// between are counted: "CRC error (x37 in last 1000 ms)"
+#define LOG_REPEAT_FORMAT		" (x%u in last %lu ms)"
+#define LOG_EVERY(level, period, fmt, ...)	do { LOG_CHECK(fmt, ##__VA_ARGS__); static LogLimiter _log_limit; \
+	if ((level) >= logger.logLevel() && _log_limit.pass(millis(), (period))) \
+		LOG_REPEATED((level), _log_limit.count(), _log_limit.span(), fmt, ##__VA_ARGS__); } while (0)
+
+// below LOG_MIN_LEVEL only the format check is left, no code, no strings
+#if LOG_MIN_LEVEL <= LOG_LEVEL_VERBOSE
+#define VERBOSEF(fmt,...)		LOG_AT(LogLevels::Verbose, fmt, __VA_ARGS__)
+#define VERBOSE(fmt)			LOG_AT(LogLevels::Verbose, fmt)
+#define VERBOSEF_EVERY(period,fmt,...)	LOG_EVERY(LogLevels::Verbose, period, fmt, __VA_ARGS__)
+#define VERBOSE_EVERY(period,fmt)		LOG_EVERY(LogLevels::Verbose, period, fmt)
+#else
+#define VERBOSEF(fmt,...)		LOG_CHECK(fmt, __VA_ARGS__)
+#define VERBOSE(fmt)			LOG_CHECK(fmt)
+#define VERBOSEF_EVERY(period,fmt,...)	LOG_CHECK(fmt, __VA_ARGS__)
+#define VERBOSE_EVERY(period,fmt)		LOG_CHECK(fmt)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define DEBUGF(fmt,...)			LOG_AT(LogLevels::Debug, fmt, __VA_ARGS__)
+#define DEBUG(fmt)				LOG_AT(LogLevels::Debug, fmt)
+#define DEBUGF_EVERY(period,fmt,...)	LOG_EVERY(LogLevels::Debug, period, fmt, __VA_ARGS__)
+#define DEBUG_EVERY(period,fmt)		LOG_EVERY(LogLevels::Debug, period, fmt)
+#define DUMP(var) {if (LogLevels::Debug >= logger.logLevel()) {logger.debug().print(#var); logger.print("="); logger.print(var); logger.end();}}
+#else
+#define DEBUGF(fmt,...)			LOG_CHECK(fmt, __VA_ARGS__)
+#define DEBUG(fmt)				LOG_CHECK(fmt)
+#define DEBUGF_EVERY(period,fmt,...)	LOG_CHECK(fmt, __VA_ARGS__)
+#define DEBUG_EVERY(period,fmt)		LOG_CHECK(fmt)
+#define DUMP(var)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define INFOF(fmt,...)			LOG_AT(LogLevels::Info, fmt, __VA_ARGS__)
+#define INFO(fmt)				LOG_AT(LogLevels::Info, fmt)
+#define INFOF_EVERY(period,fmt,...)	LOG_EVERY(LogLevels::Info, period, fmt, __VA_ARGS__)
+#define INFO_EVERY(period,fmt)		LOG_EVERY(LogLevels::Info, period, fmt)
+#else
+#define INFOF(fmt,...)			LOG_CHECK(fmt, __VA_ARGS__)
+#define INFO(fmt)				LOG_CHECK(fmt)
+#define INFOF_EVERY(period,fmt,...)	LOG_CHECK(fmt, __VA_ARGS__)
+#define INFO_EVERY(period,fmt)		LOG_CHECK(fmt)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#define WARNF(fmt,...)			LOG_AT(LogLevels::Warn, fmt, __VA_ARGS__)
+#define WARN(fmt)				LOG_AT(LogLevels::Warn, fmt)
+#define WARNF_EVERY(period,fmt,...)	LOG_EVERY(LogLevels::Warn, period, fmt, __VA_ARGS__)
+#define WARN_EVERY(period,fmt)		LOG_EVERY(LogLevels::Warn, period, fmt)
+#else
+#define WARNF(fmt,...)			LOG_CHECK(fmt, __VA_ARGS__)
+#define WARN(fmt)				LOG_CHECK(fmt)
+#define WARNF_EVERY(period,fmt,...)	LOG_CHECK(fmt, __VA_ARGS__)
+#define WARN_EVERY(period,fmt)		LOG_CHECK(fmt)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+#define ERRORF(fmt,...)			LOG_AT(LogLevels::Error, fmt, __VA_ARGS__)
+#define ERROR(fmt)				LOG_AT(LogLevels::Error, fmt)
+#define ERRORF_EVERY(period,fmt,...)	LOG_EVERY(LogLevels::Error, period, fmt, __VA_ARGS__)
+#define ERROR_EVERY(period,fmt)		LOG_EVERY(LogLevels::Error, period, fmt)
+#else
+#define ERRORF(fmt,...)			LOG_CHECK(fmt, __VA_ARGS__)
+#define ERROR(fmt)				LOG_CHECK(fmt)
+#define ERRORF_EVERY(period,fmt,...)	LOG_CHECK(fmt, __VA_ARGS__)
+#define ERROR_EVERY(period,fmt)		LOG_CHECK(fmt)
+#endif
+
+#define TRACE {DEBUGF("%s[%d]",__PRETTY_FUNCTION__, __LINE__);}
+
+#else
+
+#define __TRACE
+#define VERBOSEF(fmt,...)
+#define DEBUGF(fmt,...)
+#define INFOF(fmt,...)
+#define WARNF(fmt,...)
+#define ERRORF(fmt,...)
+
+#define VERBOSE(fmt)
+#define DEBUG(fmt)
+#define INFO(fmt)
+#define WARN(fmt)
+#define ERROR(fmt)
+
+#define VERBOSEF_EVERY(period,fmt,...)
+#define DEBUGF_EVERY(period,fmt,...)
+#define INFOF_EVERY(period,fmt,...)
+#define WARNF_EVERY(period,fmt,...)
+#define ERRORF_EVERY(period,fmt,...)
+
+#define VERBOSE_EVERY(period,fmt)
+#define DEBUG_EVERY(period,fmt)
+#define INFO_EVERY(period,fmt)
+#define WARN_EVERY(period,fmt)
+#define ERROR_EVERY(period,fmt)
+
+#define DUMP(var)
+#define TRACE
+#define LOG_DRAIN()
+#endif
+
+enum LogLevels : uint8_t
+{
+	Verbose = 0,
+	Debug,
+	Info,
+	Warn,
+	Error
+};
+
+class Logger : public Print
+{
+private:
+	uint8_t currentIndex = 0;
+	LogLevels currentLevel = LogLevels::Verbose;
+	LogLevels setLevel = LogLevels::Verbose;
+	bool isEnded = true;
+	char textBuffer[BUFFER_SIZE];
+
+	virtual size_t write(uint8_t ch) override;
+
+	void flush();
+
+	void pushHex(uint8_t number);
+	void pushHex16(uint16_t number);
+
+	void convertFlashStringToCharArray(const __FlashStringHelper * src, char * dest, size_t size);
+public:
+
+	void(*flushPipe)(const char * buffer, const uint8_t length);
+	void setLogLevel(const LogLevels level);
+	inline LogLevels logLevel() const {
+		return setLevel;
+	}
+	Logger & printArrayHex(const uint8_t * arr, uint8_t length);
+	Logger & printArrayHex16(const uint16_t * arr, uint8_t length);
+	Logger & printBool(const bool value);
+	Logger & printf(const char * fmt, ...) __attribute__((format(printf, 2, 3)));
+	Logger & printf(const __FlashStringHelper * fmt, ...);
+
+	Logger & begin(const LogLevels level);
+	Logger & verbose();
+	Logger & debug();
+	Logger & info();
+	Logger & warn();
+	Logger & error();
+	void end();
+};
+
+/// state of one *_EVERY call site, constant initialized, no guard or constructor call
+class LogLimiter
+{
+public:
+	/// false: hold this call back, it is counted into the next line that passes
+	bool pass(const uint32_t now, const uint32_t period) {
+		if (m_pending < UINT16_MAX)
+			m_pending++;
+		if (m_started && now - m_last_ms < period)
+			return false;
+
+		m_count = m_pending;
+		m_span = now - m_last_ms;
+		m_pending = 0;
+		m_last_ms = now;
+		m_started = true;
+		return true;
+	}
+
+	/// calls the line that passed stands for, itself included
+	inline uint16_t count() const {
+		return m_count;
+	}
+
+	/// ms since the previous line of this call site
+	inline uint32_t span() const {
+		return m_span;
+	}
+
+private:
+	uint32_t m_last_ms{ 0 };
+	uint32_t m_span{ 0 };
+	uint16_t m_pending{ 0 };
+	uint16_t m_count{ 0 };
+	bool m_started{ false };
+};
+
+extern Logger logger;
\ No newline at end of file
@@ -0,0 +1,197 @@
+#pragma once
+
+/*
+* ---PackedSchema---
+* Bit-level packet layout, for messages where every byte on air counts.
+* Fields are written LSB first, one after another, without byte alignment:
+*
+*    namespace Packed {
+*        struct From : BitField<Msg, uint8_t, &Msg::from, 4> {};
+*        struct On   : BitField<Msg, bool, &Msg::on, 1> {};
+*        struct X    : ScaledField<Msg, int16_t, &Msg::x, 6, -100, 100> {};
+*    }
+*    typedef PackedSchema<Msg, Packed::From, Packed::On, Packed::X> MsgSchema;  // 11 bits -> 2 bytes
+*
+*    MsgSchema::encode(msg, packet);   // packet.length() == MsgSchema::size
+*    MsgSchema::decode(packet, msg);
+*
+* ScaledField quantizes [lo, hi] linearly to 2^bits - 1 steps, values are
+* clamped to the range and rounded to the nearest step.
+* ------------------
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+class BitWriter {
+public:
+	BitWriter(uint8_t * buffer, const uint8_t size)
+		: m_buffer(buffer) {
+		memset(m_buffer, 0, size);
+	}
+
+	/// append the low 'bits' bits of value
+	void write(uint32_t value, uint8_t bits) {
+		while (bits > 0) {
+			const uint8_t used = m_position & 0x07;
+			const uint8_t count = (8 - used) < bits ? (8 - used) : bits;
+			m_buffer[m_position >> 3] |= (value & ((1UL << count) - 1)) << used;
+			value >>= count;
+			bits -= count;
+			m_position += count;
+		}
+	}
+
+	inline uint16_t position() const {
+		return m_position;
+	}
+
+private:
+	uint8_t * const m_buffer;
+	uint16_t m_position{ 0 };
+};
+
+class BitReader {
+public:
+	BitReader(const uint8_t * buffer)
+		: m_buffer(buffer) {
+	}
+
+	uint32_t read(const uint8_t bits) {
+		uint32_t value = 0;
+		uint8_t done = 0;
+		while (done < bits) {
+			const uint8_t used = m_position & 0x07;
+			const uint8_t count = (8 - used) < (bits - done) ? (8 - used) : (bits - done);
+			const uint32_t chunk = (m_buffer[m_position >> 3] >> used) & ((1UL << count) - 1);
+			value |= chunk << done;
+			done += count;
+			m_position += count;
+		}
+		return value;
+	}
+
+	inline uint16_t position() const {
+		return m_position;
+	}
+
+private:
+	const uint8_t * const m_buffer;
+	uint16_t m_position{ 0 };
+};
+
+/// member stored as its low 'fieldBits' bits
+template <typename Message, typename T, T Message::*member, uint8_t fieldBits>
+struct BitField {
+	static constexpr uint8_t bits = fieldBits;
+
+	static inline void encode(const Message & message, BitWriter & writer) {
+		writer.write((uint32_t)(message.*member), bits);
+	}
+
+	static inline void decode(BitReader & reader, Message & message) {
+		message.*member = (T)reader.read(bits);
+	}
+};
+
+/// member quantized from [lo, hi] to 'fieldBits' bits
+template <typename Message, typename T, T Message::*member, uint8_t fieldBits, int32_t lo, int32_t hi>
+struct ScaledField {
+	static_assert(hi > lo, "empty range");
+	static constexpr uint8_t bits = fieldBits;
+	static constexpr uint32_t steps = (1UL << fieldBits) - 1;
+
+	static inline void encode(const Message & message, BitWriter & writer) {
+		int32_t value = message.*member;
+		if (value < lo)
+			value = lo;
+		if (value > hi)
+			value = hi;
+		writer.write(((uint32_t)(value - lo) * steps + (hi - lo) / 2) / (hi - lo), bits);
+	}
+
+	static inline void decode(BitReader & reader, Message & message) {
+		const uint32_t q = reader.read(bits);
+		message.*member = (T)(lo + (int32_t)((q * (hi - lo) + steps / 2) / steps));
+	}
+};
+
+/// unused bits, always written as 0
+template <typename Message, uint8_t fieldBits>
+struct PaddingField {
+	static constexpr uint8_t bits = fieldBits;
+
+	static inline void encode(const Message &, BitWriter & writer) {
+		writer.write(0, bits);
+	}
+
+	static inline void decode(BitReader & reader, Message &) {
+		reader.read(bits);
+	}
+};
+
+/// constant tag (e.g. message type), written as 'value', skipped on decode
+template <typename Message, uint8_t fieldBits, uint32_t value>
+struct ConstField {
+	static_assert(value < (1UL << fieldBits), "value does not fit in the field");
+	static constexpr uint8_t bits = fieldBits;
+
+	static inline void encode(const Message &, BitWriter & writer) {
+		writer.write(value, bits);
+	}
+
+	static inline void decode(BitReader & reader, Message &) {
+		reader.read(bits);
+	}
+};
+
+template <typename Message, typename... Fields>
+struct PackedCodec;
+
+template <typename Message>
+struct PackedCodec<Message> {
+	static constexpr uint16_t bits = 0;
+	static inline void encode(const Message &, BitWriter &) {}
+	static inline void decode(BitReader &, Message &) {}
+};
+
+template <typename Message, typename Head, typename... Rest>
+struct PackedCodec<Message, Head, Rest...> {
+	static constexpr uint16_t bits = Head::bits + PackedCodec<Message, Rest...>::bits;
+
+	static inline void encode(const Message & message, BitWriter & writer) {
+		Head::encode(message, writer);
+		PackedCodec<Message, Rest...>::encode(message, writer);
+	}
+
+	static inline void decode(BitReader & reader, Message & message) {
+		Head::decode(reader, message);
+		PackedCodec<Message, Rest...>::decode(reader, message);
+	}
+};
+
+template <typename Message, typename... Fields>
+struct PackedSchema {
+	static constexpr uint16_t bits = PackedCodec<Message, Fields...>::bits;
+	/// bytes occupied by all fields
+	static constexpr uint8_t size = (bits + 7) / 8;
+
+	/// true if the schema fits in a DataPacker2<packetSize> (seed + CRC take 3 bytes)
+	static constexpr bool fits(const uint8_t packetSize) {
+		return size + 3 <= packetSize;
+	}
+
+	/// write 'message' from the start of 'packet', the packet length is set to size
+	template <typename Packet>
+	static void encode(const Message & message, Packet & packet) {
+		BitWriter writer(packet.getBuffer(), size);
+		PackedCodec<Message, Fields...>::encode(message, writer);
+		packet.setLength(size);
+	}
+
+	template <typename Packet>
+	static void decode(const Packet & packet, Message & message) {
+		BitReader reader(packet.getBuffer());
+		PackedCodec<Message, Fields...>::decode(reader, message);
+	}
+};
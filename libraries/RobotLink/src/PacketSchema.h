@@ -0,0 +1,143 @@
+#pragma once
+
+/*
+* ---PacketSchema---
+* Compile-time packet layout for DataPacker2.
+* Every field is a type that knows its value type and the field before it,
+* so offsets are constants and DataPacker2::get<Field>() / put<Field>()
+* compile down to a single (unaligned-safe) load / store.
+*
+*    namespace Field {
+*        struct From : SchemaField<uint8_t> {};
+*        struct To   : SchemaField<uint8_t, From> {};
+*        struct X    : SchemaField<int16_t, To> {};
+*    }
+*    typedef PacketSchema<Field::From, Field::To, Field::X> MySchema;
+*
+*    packet.put<Field::X>(123);
+*    int16_t x = packet.get<Field::X>();
+*
+* PacketSchema<> checks that the list matches the chain and gives the total size.
+*
+* MessageField / MessageSchema bind each field to a member of a plain struct,
+* encode() and decode() are then generated from the same field list:
+*
+*    struct Msg { uint8_t from; int16_t x; };
+*    namespace Field {
+*        struct From : MessageField<Msg, uint8_t, &Msg::from> {};
+*        struct X    : MessageField<Msg, int16_t, &Msg::x, From> {};
+*    }
+*    typedef MessageSchema<Msg, Field::From, Field::X> MsgSchema;
+*
+*    MsgSchema::encode(msg, packet);
+*    MsgSchema::decode(packet, msg);
+* ------------------
+*/
+
+#include <stdint.h>
+
+/// chain anchor, offset of the first field is 0
+struct SchemaBegin {
+	static constexpr uint8_t offset = 0;
+	static constexpr uint8_t end = 0;
+};
+
+template <typename T, typename Previous = SchemaBegin>
+struct SchemaField {
+	typedef T type;
+	typedef Previous previous;
+	static constexpr uint8_t offset = Previous::end;
+	static constexpr uint8_t end = offset + sizeof(T);
+};
+
+template <typename A, typename B>
+struct SchemaSame {
+	static constexpr bool value = false;
+};
+
+template <typename A>
+struct SchemaSame<A, A> {
+	static constexpr bool value = true;
+};
+
+template <typename Previous, typename... Fields>
+struct SchemaChain;
+
+template <typename Previous>
+struct SchemaChain<Previous> {
+	static constexpr uint8_t size = Previous::end;
+	static constexpr uint8_t count = 0;
+};
+
+template <typename Previous, typename Head, typename... Rest>
+struct SchemaChain<Previous, Head, Rest...> {
+	static_assert(SchemaSame<typename Head::previous, Previous>::value, "schema fields are not listed in chain order");
+	static constexpr uint8_t size = SchemaChain<Head, Rest...>::size;
+	static constexpr uint8_t count = 1 + SchemaChain<Head, Rest...>::count;
+};
+
+template <typename... Fields>
+struct PacketSchema {
+	/// bytes occupied by all fields
+	static constexpr uint8_t size = SchemaChain<SchemaBegin, Fields...>::size;
+	static constexpr uint8_t count = SchemaChain<SchemaBegin, Fields...>::count;
+
+	/// true if the schema fits in a DataPacker2<packetSize> (seed + CRC take 3 bytes)
+	static constexpr bool fits(const uint8_t packetSize) {
+		return size + 3 <= packetSize;
+	}
+};
+
+/// schema field stored in (and loaded from) a member of 'Message'
+template <typename Message, typename T, T Message::*member, typename Previous = SchemaBegin>
+struct MessageField : SchemaField<T, Previous> {
+	static inline const T & load(const Message & message) {
+		return message.*member;
+	}
+
+	static inline void store(Message & message, const T & value) {
+		message.*member = value;
+	}
+};
+
+template <typename Message, typename... Fields>
+struct MessageCodec;
+
+template <typename Message>
+struct MessageCodec<Message> {
+	template <typename Packet>
+	static inline void encode(const Message &, Packet &) {}
+
+	template <typename Packet>
+	static inline void decode(const Packet &, Message &) {}
+};
+
+template <typename Message, typename Head, typename... Rest>
+struct MessageCodec<Message, Head, Rest...> {
+	template <typename Packet>
+	static inline void encode(const Message & message, Packet & packet) {
+		packet.template put<Head>(Head::load(message));
+		MessageCodec<Message, Rest...>::encode(message, packet);
+	}
+
+	template <typename Packet>
+	static inline void decode(const Packet & packet, Message & message) {
+		Head::store(message, packet.template get<Head>());
+		MessageCodec<Message, Rest...>::decode(packet, message);
+	}
+};
+
+template <typename Message, typename... Fields>
+struct MessageSchema : PacketSchema<Fields...> {
+	/// write every field of 'message' to its place in 'packet'
+	template <typename Packet>
+	static inline void encode(const Message & message, Packet & packet) {
+		MessageCodec<Message, Fields...>::encode(message, packet);
+	}
+
+	/// read every field of 'message' from 'packet'
+	template <typename Packet>
+	static inline void decode(const Packet & packet, Message & message) {
+		MessageCodec<Message, Fields...>::decode(packet, message);
+	}
+};
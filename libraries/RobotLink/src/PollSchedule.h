@@ -0,0 +1,116 @@
+#pragma once
+
+/*
+* ---PollSchedule---
+* Time slots for one Controller driving several robots (UART_TDMA).
+* The Controller polls the robots in a fixed cycle, each slot is one
+* half-duplex turn: command to the robot, the robot's reply.
+* A robot only talks right after it was polled (UART_HALF_DUPLEX slave),
+* so replies can never collide.
+*
+*    | robot 2 | robot 3 | robot 5 | robot 2 | ...
+*    |<-slot->|
+*
+* Slot length comes from the packet sizes and the air rate (turnAirtimeUs()),
+* a slot ends early when its robot replied, so the cycle only stretches to
+* the worst case for robots that stay silent.
+*
+*    poll.add(robot, AsyncUart::turnUs(ControlSchema::size, TelemetrySteps::size));
+*    const auto * slot = lora.clearToSend() ? poll.due(micros()) : nullptr;
+*    if (slot != nullptr && lora.write(packet_for(slot->address), slot->length_us))
+*        poll.polled(micros());
+*    on reply: poll.replied(address);
+*
+* A poll the radio refused does not start the slot, the same robot is due again.
+* ------------------
+*/
+
+#include <stdint.h>
+
+template <uint8_t maxRobots = 15>
+class PollSchedule {
+public:
+    struct Slot {
+        uint8_t address;
+        uint32_t length_us;
+        uint16_t polls;
+        uint16_t replies;
+        uint32_t last_poll_us;
+        uint32_t interval_us;       // time between the last two polls = command latency bound
+    };
+
+    /// add a robot to the cycle, false if the schedule is full
+    bool add(const uint8_t address, const uint32_t slot_us) {
+        if (m_count >= maxRobots)
+            return false;
+        Slot & slot = m_slots[m_count++];
+        slot.address = address;
+        slot.length_us = slot_us;
+        slot.polls = 0;
+        slot.replies = 0;
+        slot.last_poll_us = 0;
+        slot.interval_us = 0;
+        return true;
+    }
+
+    /// slot that may start now, nullptr while the current one runs; nothing changes until polled()
+    const Slot * due(const uint32_t now_us) const {
+        if (m_count == 0)
+            return nullptr;
+        if (!m_running)
+            return &m_slots[m_current];
+        if (!m_replied && now_us - m_slot_start_us < m_slots[m_current].length_us)
+            return nullptr;
+        return &m_slots[(m_current + 1) % m_count];
+    }
+
+    /// the poll for the slot from due() went out, the slot starts now
+    void polled(const uint32_t now_us) {
+        if (m_count == 0)
+            return;
+        if (m_running)
+            m_current = (m_current + 1) % m_count;
+
+        Slot & slot = m_slots[m_current];
+        if (slot.polls > 0)
+            slot.interval_us = now_us - slot.last_poll_us;
+        slot.last_poll_us = now_us;
+        slot.polls++;
+
+        m_running = true;
+        m_replied = false;
+        m_slot_start_us = now_us;
+    }
+
+    /// a reply from 'address' came in, its slot is done
+    void replied(const uint8_t address) {
+        if (!m_running || m_slots[m_current].address != address)
+            return;     // late reply from a previous slot
+        m_slots[m_current].replies++;
+        m_replied = true;
+    }
+
+    inline uint8_t count() const {
+        return m_count;
+    }
+
+    inline const Slot & slot(const uint8_t index) const {
+        return m_slots[index];
+    }
+
+    /// worst case cycle, every robot silent
+    uint32_t cycleUs() const {
+        uint32_t total = 0;
+        for (uint8_t i = 0; i < m_count; ++i)
+            total += m_slots[i].length_us;
+        return total;
+    }
+
+private:
+    Slot m_slots[maxRobots];
+    uint8_t m_count{ 0 };
+    uint8_t m_current{ 0 };
+    bool m_running{ false };
+    bool m_replied{ false };
+    uint32_t m_slot_start_us{ 0 };
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+/*
+* ---RateNegotiator---
+* Moves Controller and Receiver to a faster air data rate together, and back
+* to the base rate if the faster one does not work. No hardware access:
+* the sketch carries the proposal (reliable lane) and switches the module
+* (E32Module) whenever update() says so.
+*
+* Controller (master)                      Receiver (slave)
+*   proposal() -> send rate  ----------->    onProposal(rate)
+*   onAcked()  <- lane ack   <-----------    (ack rides on its reply)
+*   after RATE_SWITCH_DELAY_MS: switch       after RATE_SWITCH_DELAY_MS: switch
+*   probation: wait for a reply              probation: wait for a command
+*   no reply in RATE_PROBATION_MS:           nothing in RATE_PROBATION_MS:
+*     back to base, retry one step slower      back to base
+*     after RATE_RETRY_MS
+*
+* Once settled, losing the link for RATE_LINK_LOSS_MS also falls back to base
+* on both sides, they then meet again at the base rate and renegotiate.
+* ------------------
+*/
+
+#include <stdint.h>
+
+#ifndef RATE_SWITCH_DELAY_MS
+#define RATE_SWITCH_DELAY_MS 300
+#endif
+
+#ifndef RATE_PROBATION_MS
+#define RATE_PROBATION_MS 1500
+#endif
+
+#ifndef RATE_LINK_LOSS_MS
+#define RATE_LINK_LOSS_MS 3000
+#endif
+
+// give up on an unacknowledged proposal, longer than the lane retries
+#ifndef RATE_PROPOSAL_TIMEOUT_MS
+#define RATE_PROPOSAL_TIMEOUT_MS 15000
+#endif
+
+// master: time at the base rate before proposing again after a failure
+#ifndef RATE_RETRY_MS
+#define RATE_RETRY_MS 5000
+#endif
+
+class RateNegotiator {
+public:
+    enum class State : uint8_t {
+        BASE,           // at the base rate, nothing going on
+        PROPOSED,       // master: waiting for the ack
+        SWITCHING,      // switch at m_deadline_ms
+        PROBATION,      // switched, waiting for the peer at the new rate
+        SETTLED         // running at the faster rate
+    };
+
+    RateNegotiator(const bool master, const uint8_t base_rate, const uint8_t target_rate)
+        : m_master(master),
+        m_base(base_rate),
+        m_target(target_rate),
+        m_current(base_rate) {
+    }
+
+    /// master: rate to propose now, false if nothing to propose
+    bool proposal(const uint32_t now_ms, uint8_t & rate) {
+        if (!m_master || m_state != State::BASE || m_target <= m_base
+            || (int32_t)(now_ms - m_deadline_ms) < 0)
+            return false;
+        m_state = State::PROPOSED;
+        m_pending = m_target;
+        m_deadline_ms = now_ms + RATE_PROPOSAL_TIMEOUT_MS;
+        rate = m_pending;
+        return true;
+    }
+
+    /// master: the peer acknowledged the proposal
+    void onAcked(const uint32_t now_ms) {
+        if (m_state != State::PROPOSED)
+            return;
+        m_state = State::SWITCHING;
+        m_deadline_ms = now_ms + RATE_SWITCH_DELAY_MS;
+    }
+
+    /// slave: the master proposed 'rate'
+    void onProposal(const uint8_t rate, const uint32_t now_ms) {
+        if (m_master)
+            return;
+        m_pending = rate;
+        m_state = State::SWITCHING;
+        m_deadline_ms = now_ms + RATE_SWITCH_DELAY_MS;
+    }
+
+    /// a valid packet from the peer came in
+    void onLink(const uint32_t now_ms) {
+        m_last_link_ms = now_ms;
+        if (m_state == State::PROBATION) {
+            m_state = State::SETTLED;
+            m_current = m_pending;
+        }
+    }
+
+    /// true if the module must switch to 'rate' now
+    bool update(const uint32_t now_ms, uint8_t & rate) {
+        const bool expired = (int32_t)(now_ms - m_deadline_ms) >= 0;
+
+        switch (m_state) {
+        case State::PROPOSED:
+            if (expired) {
+                m_state = State::BASE;
+                m_deadline_ms = now_ms + RATE_RETRY_MS;
+            }
+            return false;
+
+        case State::SWITCHING:
+            if (!expired)
+                return false;
+            m_state = State::PROBATION;
+            m_deadline_ms = now_ms + RATE_PROBATION_MS;
+            rate = m_pending;
+            return true;
+
+        case State::PROBATION:
+            if (!expired)
+                return false;
+            // the peer is not there at this rate
+            if (m_master && m_target > m_base)
+                m_target--;
+            return fallBack(now_ms, rate);
+
+        case State::SETTLED:
+            if (now_ms - m_last_link_ms < RATE_LINK_LOSS_MS)
+                return false;
+            return fallBack(now_ms, rate);
+
+        default:
+            return false;
+        }
+    }
+
+    inline State state() const {
+        return m_state;
+    }
+
+    /// rate the module runs at once settled
+    inline uint8_t current() const {
+        return m_current;
+    }
+
+private:
+    bool fallBack(const uint32_t now_ms, uint8_t & rate) {
+        m_state = State::BASE;
+        m_deadline_ms = now_ms + RATE_RETRY_MS;
+        m_current = m_base;
+        rate = m_base;
+        return true;
+    }
+
+    const bool m_master;
+    const uint8_t m_base;
+    uint8_t m_target;
+    uint8_t m_current;
+    uint8_t m_pending{ 0 };
+    State m_state{ State::BASE };
+    uint32_t m_deadline_ms{ 0 };
+    uint32_t m_last_link_ms{ 0 };
+};
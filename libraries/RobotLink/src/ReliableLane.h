@@ -0,0 +1,261 @@
+#pragma once
+
+/*
+* ---ReliableLane---
+* Acknowledged delivery for one-shot messages ("set parameter", ...),
+* riding on the packets the link sends anyway, it never sends a packet itself.
+*
+* Trailer at the end of a packet's payload:
+*    [message data][id][length]   only if M is set
+*    [descriptor]                 always
+*
+* descriptor: bit 7 M: a message is attached
+*             bit 6 A: bits 0..5 acknowledge message id
+*
+* Stop-and-wait: one message in flight per lane, retransmitted with
+* exponential backoff (ARQ_RETRY_MS doubling up to ARQ_RETRY_MAX_MS) until
+* acknowledged or ARQ_MAX_TRIES is reached. Receivers acknowledge every copy
+* but deliver an id only once per sender. The last id and a digest of its
+* data are remembered for as long as the sender may still retransmit it.
+* A sender rebooted within that time starts at a random id (seed()), its
+* first message is only taken for a duplicate if it also repeats the data.
+* A message that does not fit in the room left in a packet waits for a
+* packet with more room.
+* ------------------
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef ARQ_MAX_MESSAGE
+#define ARQ_MAX_MESSAGE 8
+#endif
+
+#ifndef ARQ_RETRY_MS
+#define ARQ_RETRY_MS 200
+#endif
+
+#ifndef ARQ_RETRY_MAX_MS
+#define ARQ_RETRY_MAX_MS 1600
+#endif
+
+#ifndef ARQ_MAX_TRIES
+#define ARQ_MAX_TRIES 8
+#endif
+
+template <uint8_t queueSize = 4>
+class ReliableLane {
+public:
+    /// bytes every packet carries for the lane
+    static constexpr uint8_t overhead = 1;
+
+    /// bytes a message riding along adds on top of overhead, at most
+    static constexpr uint8_t messageOverhead = ARQ_MAX_MESSAGE + 2;
+
+    struct Message {
+        uint8_t peer;       // receiver when sending, sender when received
+        uint8_t length;
+        uint8_t data[ARQ_MAX_MESSAGE];
+    };
+
+    ReliableLane() {
+        memset(m_last_rx_id, no_id, sizeof(m_last_rx_id));
+    }
+
+    /// first message id from something that differs between boots, see bootEntropy()
+    void seed(const uint32_t entropy) {
+        m_tx_id = (entropy ^ (entropy >> 8) ^ (entropy >> 16) ^ (entropy >> 24)) & id_mask;
+    }
+
+    /// queue a message for 'to', false if the queue is full or the message too long
+    bool send(const uint8_t to, const uint8_t * data, const uint8_t length) {
+        if (m_tx_count >= queueSize || length > ARQ_MAX_MESSAGE)
+            return false;
+        Message & m = m_tx[(m_tx_head + m_tx_count) % queueSize];
+        m.peer = to;
+        m.length = length;
+        memcpy(m.data, data, length);
+        m_tx_count++;
+        return true;
+    }
+
+    /// write the trailer for a packet to 'to' at 'dest', at most 'room' bytes
+    /// return bytes written, 0 if not even the descriptor fits
+    uint8_t attach(uint8_t * dest, const uint8_t room, const uint8_t to, const uint32_t now_ms) {
+        if (room < overhead)
+            return 0;
+
+        uint8_t used = 0;
+        uint8_t descriptor = 0;
+
+        if (m_tx_count > 0) {
+            Message & m = m_tx[m_tx_head];
+            const bool due = m_tries == 0 || now_ms - m_last_try_ms >= retryInterval();
+            if (m.peer == to && due && m.length + 2 + overhead <= room) {
+                if (m_tries > 0)
+                    m_retransmits++;
+                memcpy(dest, m.data, m.length);
+                dest[m.length] = m_tx_id;
+                dest[m.length + 1] = m.length;
+                used = m.length + 2;
+                descriptor |= flag_message;
+                m_tries++;
+                m_last_try_ms = now_ms;
+            }
+        }
+
+        if (m_ack_pending && m_ack_peer == to) {
+            descriptor |= flag_ack | m_ack_id;
+            m_ack_pending = false;
+        }
+
+        dest[used] = descriptor;
+        return used + overhead;
+    }
+
+    /// give up on a message after ARQ_MAX_TRIES, call periodically
+    void update(const uint32_t now_ms) {
+        if (m_tx_count > 0 && m_tries >= ARQ_MAX_TRIES && now_ms - m_last_try_ms >= retryInterval()) {
+            m_failed++;
+            nextMessage();
+        }
+    }
+
+    /// read the trailer at the end of 'packet' from 'from'
+    /// return trailer size to strip, -1 if malformed
+    int16_t detach(const uint8_t * packet, const uint8_t length, const uint8_t from, const uint32_t now_ms) {
+        if (length < overhead)
+            return -1;
+
+        const uint8_t descriptor = packet[length - 1];
+        int16_t used = overhead;
+
+        if ((descriptor & flag_ack) && m_tx_count > 0 && m_tries > 0
+            && m_tx[m_tx_head].peer == from && (descriptor & id_mask) == m_tx_id)
+            nextMessage();
+
+        if (descriptor & flag_message) {
+            if (length < overhead + 2)
+                return -1;
+            const uint8_t size = packet[length - 2];
+            const uint8_t id = packet[length - 3] & id_mask;
+            if (size > ARQ_MAX_MESSAGE || length < overhead + 2 + size)
+                return -1;
+            used += 2 + size;
+
+            const uint8_t peer = from & 0x0F;
+            if (now_ms - m_last_rx_ms[peer] > ARQ_RETRY_MAX_MS * ARQ_MAX_TRIES)
+                m_last_rx_id[peer] = no_id;
+
+            const uint8_t * const data = packet + length - 3 - size;
+            const uint8_t data_digest = digest(data, size);
+            if (id == m_last_rx_id[peer] && data_digest == m_last_rx_digest[peer]) {
+                m_last_rx_ms[peer] = now_ms;
+                m_duplicates++;     // our ack was lost, acknowledge again
+                acknowledge(from, id);
+            }
+            else if (m_rx_count < queueSize) {
+                Message & m = m_rx[(m_rx_head + m_rx_count) % queueSize];
+                m.peer = from;
+                m.length = size;
+                memcpy(m.data, data, size);
+                m_rx_count++;
+                m_last_rx_id[peer] = id;
+                m_last_rx_digest[peer] = data_digest;
+                m_last_rx_ms[peer] = now_ms;
+                acknowledge(from, id);
+            }
+            // else: no room, no ack, the sender retries later
+        }
+        return used;
+    }
+
+    inline bool available() const {
+        return m_rx_count > 0;
+    }
+
+    /// oldest received message, valid until pop()
+    inline const Message & peek() const {
+        return m_rx[m_rx_head];
+    }
+
+    void pop() {
+        if (m_rx_count == 0)
+            return;
+        m_rx_head = (m_rx_head + 1) % queueSize;
+        m_rx_count--;
+    }
+
+    /// messages still queued or in flight
+    inline uint8_t pending() const {
+        return m_tx_count;
+    }
+
+    inline uint16_t retransmits() const {
+        return m_retransmits;
+    }
+
+    inline uint16_t duplicates() const {
+        return m_duplicates;
+    }
+
+    inline uint16_t failed() const {
+        return m_failed;
+    }
+
+private:
+    static constexpr uint8_t flag_message = 0x80;
+    static constexpr uint8_t flag_ack = 0x40;
+    static constexpr uint8_t id_mask = 0x3F;
+    static constexpr uint8_t no_id = 0xFF;
+
+    uint32_t retryInterval() const {
+        uint32_t interval = ARQ_RETRY_MS;
+        for (uint8_t i = 1; i < m_tries && interval < ARQ_RETRY_MAX_MS; ++i)
+            interval <<= 1;
+        return interval < ARQ_RETRY_MAX_MS ? interval : ARQ_RETRY_MAX_MS;
+    }
+
+    /// tells a retransmission from a new message that happens to reuse the id
+    static uint8_t digest(const uint8_t * data, const uint8_t length) {
+        uint8_t d = length;
+        for (uint8_t i = 0; i < length; ++i)
+            d = (uint8_t)((d << 1) | (d >> 7)) ^ data[i];
+        return d;
+    }
+
+    void nextMessage() {
+        m_tx_head = (m_tx_head + 1) % queueSize;
+        m_tx_count--;
+        m_tx_id = (m_tx_id + 1) & id_mask;
+        m_tries = 0;
+    }
+
+    void acknowledge(const uint8_t peer, const uint8_t id) {
+        m_ack_pending = true;
+        m_ack_peer = peer;
+        m_ack_id = id;
+    }
+
+    Message m_tx[queueSize];
+    uint8_t m_tx_head{ 0 };
+    uint8_t m_tx_count{ 0 };
+    uint8_t m_tx_id{ 0 };
+    uint8_t m_tries{ 0 };
+    uint32_t m_last_try_ms{ 0 };
+
+    Message m_rx[queueSize];
+    uint8_t m_rx_head{ 0 };
+    uint8_t m_rx_count{ 0 };
+    uint8_t m_last_rx_id[16];
+    uint8_t m_last_rx_digest[16]{};
+    uint32_t m_last_rx_ms[16]{};
+
+    bool m_ack_pending{ false };
+    uint8_t m_ack_peer{ 0 };
+    uint8_t m_ack_id{ 0 };
+
+    uint16_t m_retransmits{ 0 };
+    uint16_t m_duplicates{ 0 };
+    uint16_t m_failed{ 0 };
+};
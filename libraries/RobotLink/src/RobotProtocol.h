@@ -0,0 +1,397 @@
+#pragma once
+
+/*
+* ---RobotProtocol---
+* The one definition of what goes over the radio between Controller and Receiver.
+* Both sketches encode / decode through the schemas below, so the two sides
+* cannot drift apart: adding or moving a field here changes both.
+*
+* Every packet starts with one address byte:
+*    bit 0..3: sender, bit 4..7: receiver (so addresses are 0..15)
+*
+* and one byte with the message type (MessageType) in bit 0..3 and four flags:
+*    bit 4: emergency, bit 5: enable, bit 6: relay_1, bit 7: relay_2
+*
+* Control packet, bit-packed (PROTOCOL_AXIS_BITS = 8 -> 5 bytes):
+*    from  to  | type  emergency enable relay_1 relay_2 | x     y     max_v
+*     4    4   |  4        1       1       1       1    | axis  axis  axis   bits
+*
+* Telemetry packet (Receiver -> Controller), one page per reply, the type is
+* TELEMETRY + page:
+*    from  to  | type  emergency enable relay_1 relay_2 | page fields
+*     4    4   |  4        1       1       1       1    |
+* Pages are sent in telemetry_rotation order: velocities every other reply,
+* the rest in turn, so a reply never exceeds TelemetrySteps::size bytes.
+*
+* With UART_AEAD every packet also carries a sequence number and a tag,
+* plus a challenge during handshakes (up to LinkCipher::overhead bytes),
+* the address byte stays in clear.
+*
+* Only occupied bytes are sent in framed mode (UART_FRAMED), see Airtime.h
+* to estimate what a packet costs on air.
+* ------------------
+*/
+
+#include <stdint.h>
+#include "PacketSchema.h"
+#include "PackedSchema.h"
+
+// room for the payload plus AsyncUart's link overhead (UART_AEAD, UART_LINK_STATS, UART_ARQ),
+// frames are variable-length, a bigger buffer costs RAM but no airtime
+#ifndef UART_PACKET_SIZE
+#if defined(UART_ARQ)
+#define UART_PACKET_SIZE	40
+#elif defined(UART_AEAD)
+#define UART_PACKET_SIZE	28
+#else
+#define UART_PACKET_SIZE	16
+#endif
+#endif
+
+// resolution of joystick / max velocity values on air
+#ifndef PROTOCOL_AXIS_BITS
+#define PROTOCOL_AXIS_BITS	8
+#endif
+
+constexpr uint8_t controller_id{ 0x01 };
+// flash every robot with its own ROBOT_ID when one Controller drives several (UART_TDMA)
+#ifndef ROBOT_ID
+#define ROBOT_ID 0x02
+#endif
+
+constexpr uint8_t robot_id{ ROBOT_ID };
+
+// robots one Controller polls under UART_TDMA, flash the same value into the
+// Controller and every robot: both sides size the link timeout from it
+#ifndef TDMA_ROBOTS
+#define TDMA_ROBOTS 1
+#endif
+
+// no packet from the peer for this long: the link is down, the Receiver stops the motors;
+// under UART_TDMA AsyncUart::linkTimeoutMs() stretches it to the poll cycle
+#ifndef LINK_TIMEOUT_MS
+#define LINK_TIMEOUT_MS 2000
+#endif
+
+/// what a packet carries, 4 bits right after the address byte of every packet
+enum class MessageType : uint8_t {
+    CONTROL = 0,
+    TELEMETRY = 1,      // 1..4: one per TelemetryPage
+    // 5..15 free: parameters, trajectories, ...
+};
+
+// every packet starts with the sender's and the receiver's address, one nibble each,
+// followed by the message type in the low nibble of the next byte
+namespace LinkField {
+    struct Address : SchemaField<uint8_t> {};
+
+    /// message type tag at the start of a packed schema, right after From / To
+    template <typename Message, MessageType type>
+    using Type = ConstField<Message, 4, uint8_t(type)>;
+
+    constexpr uint8_t pack(const uint8_t from, const uint8_t to) {
+        return (from & 0x0F) | (to << 4);
+    }
+
+    constexpr uint8_t from(const uint8_t address) {
+        return address & 0x0F;
+    }
+
+    constexpr uint8_t to(const uint8_t address) {
+        return address >> 4;
+    }
+
+    template <typename Packet>
+    inline uint8_t type(const Packet & packet) {
+        return packet.getBuffer()[1] & 0x0F;
+    }
+}
+
+// shared secret for UART_AEAD, change it for every fleet
+constexpr uint8_t link_key[32]{
+    0x5e, 0x1f, 0x8a, 0x2c, 0x93, 0x47, 0xd0, 0x6b, 0x21, 0xf4, 0x7e, 0xc5, 0x08, 0xb9, 0x3d, 0x62,
+    0xa7, 0x14, 0xe8, 0x5b, 0xcf, 0x30, 0x96, 0x4d, 0x7a, 0x01, 0xbe, 0x58, 0xe3, 0x2f, 0x69, 0xd4
+};
+
+static_assert(controller_id <= 0x0F && robot_id <= 0x0F, "addresses must fit in a nibble");
+
+/// Controller -> Receiver, sent periodically
+struct ControlMessage {
+    uint8_t from{ controller_id };
+    uint8_t to{ robot_id };
+    bool emergency{ true };     // true: pressed
+    bool enable{ false };
+    bool relay_1{ false };
+    bool relay_2{ false };
+    int16_t joystick_x{ 0 };    // -100 -> 100
+    int16_t joystick_y{ 0 };    // -100 -> 100
+    int16_t max_v_percent{ 0 }; // 0 -> 100
+};
+
+namespace ControlField {
+    struct From : BitField<ControlMessage, uint8_t, &ControlMessage::from, 4> {};
+    struct To : BitField<ControlMessage, uint8_t, &ControlMessage::to, 4> {};
+    struct Type : LinkField::Type<ControlMessage, MessageType::CONTROL> {};
+    struct Emergency : BitField<ControlMessage, bool, &ControlMessage::emergency, 1> {};
+    struct Enable : BitField<ControlMessage, bool, &ControlMessage::enable, 1> {};
+    struct Relay1 : BitField<ControlMessage, bool, &ControlMessage::relay_1, 1> {};
+    struct Relay2 : BitField<ControlMessage, bool, &ControlMessage::relay_2, 1> {};
+    struct JoystickX : ScaledField<ControlMessage, int16_t, &ControlMessage::joystick_x, PROTOCOL_AXIS_BITS, -100, 100> {};
+    struct JoystickY : ScaledField<ControlMessage, int16_t, &ControlMessage::joystick_y, PROTOCOL_AXIS_BITS, -100, 100> {};
+    struct MaxVelocity : ScaledField<ControlMessage, int16_t, &ControlMessage::max_v_percent, PROTOCOL_AXIS_BITS, 0, 100> {};
+}
+
+typedef PackedSchema<ControlMessage,
+    ControlField::From,
+    ControlField::To,
+    ControlField::Type,
+    ControlField::Emergency,
+    ControlField::Enable,
+    ControlField::Relay1,
+    ControlField::Relay2,
+    ControlField::JoystickX,
+    ControlField::JoystickY,
+    ControlField::MaxVelocity> ControlSchema;
+
+static_assert(ControlSchema::fits(UART_PACKET_SIZE), "control packet does not fit in UART_PACKET_SIZE");
+
+enum class TelemetryPage : uint8_t {
+    VELOCITY,   // current wheel velocities
+    STEPS,      // step counters
+    HEALTH,     // loop time, ISR load, supply voltage
+    LINK        // link quality seen by the Receiver
+};
+
+/// Receiver -> Controller, one reply per command
+struct TelemetryMessage {
+    uint8_t from{ robot_id };
+    uint8_t to{ controller_id };
+    TelemetryPage page{ TelemetryPage::VELOCITY };
+    bool emergency{ true };
+    bool enable{ false };
+    bool relay_1{ false };
+    bool relay_2{ false };
+
+    int16_t left_percent{ 0 };      // velocity, % of max
+    int16_t right_percent{ 0 };
+
+    int32_t left_steps{ 0 };        // low 24 bits on air, unwrap on the receiving side
+    int32_t right_steps{ 0 };
+
+    uint16_t loop_max_us{ 0 };      // longest loop() since the previous health page
+    uint8_t isr_load_percent{ 0 };
+    uint16_t supply_mv{ 0 };
+
+    uint8_t loss_percent{ 0 };
+    uint8_t error_percent{ 0 };
+    uint16_t rtt_ms{ 0 };           // saturates at 1023
+    uint8_t jitter_ms{ 0 };
+};
+
+namespace TelemetryField {
+    struct From : BitField<TelemetryMessage, uint8_t, &TelemetryMessage::from, 4> {};
+    struct To : BitField<TelemetryMessage, uint8_t, &TelemetryMessage::to, 4> {};
+    /// the page goes on air as message type TELEMETRY + page
+    struct Page {
+        static constexpr uint8_t bits = 4;
+
+        static inline void encode(const TelemetryMessage & message, BitWriter & writer) {
+            writer.write(uint8_t(MessageType::TELEMETRY) + uint8_t(message.page), bits);
+        }
+
+        static inline void decode(BitReader & reader, TelemetryMessage & message) {
+            message.page = TelemetryPage(reader.read(bits) - uint8_t(MessageType::TELEMETRY));
+        }
+    };
+    struct Emergency : BitField<TelemetryMessage, bool, &TelemetryMessage::emergency, 1> {};
+    struct Enable : BitField<TelemetryMessage, bool, &TelemetryMessage::enable, 1> {};
+    struct Relay1 : BitField<TelemetryMessage, bool, &TelemetryMessage::relay_1, 1> {};
+    struct Relay2 : BitField<TelemetryMessage, bool, &TelemetryMessage::relay_2, 1> {};
+
+    struct LeftVelocity : ScaledField<TelemetryMessage, int16_t, &TelemetryMessage::left_percent, 8, -100, 100> {};
+    struct RightVelocity : ScaledField<TelemetryMessage, int16_t, &TelemetryMessage::right_percent, 8, -100, 100> {};
+
+    struct LeftSteps : BitField<TelemetryMessage, int32_t, &TelemetryMessage::left_steps, 24> {};
+    struct RightSteps : BitField<TelemetryMessage, int32_t, &TelemetryMessage::right_steps, 24> {};
+
+    struct LoopMax : BitField<TelemetryMessage, uint16_t, &TelemetryMessage::loop_max_us, 16> {};
+    struct IsrLoad : BitField<TelemetryMessage, uint8_t, &TelemetryMessage::isr_load_percent, 7> {};
+    struct Supply : ScaledField<TelemetryMessage, uint16_t, &TelemetryMessage::supply_mv, 8, 0, 25500> {};
+
+    struct Loss : BitField<TelemetryMessage, uint8_t, &TelemetryMessage::loss_percent, 7> {};
+    struct Errors : BitField<TelemetryMessage, uint8_t, &TelemetryMessage::error_percent, 7> {};
+    struct Rtt : BitField<TelemetryMessage, uint16_t, &TelemetryMessage::rtt_ms, 10> {};
+    struct Jitter : BitField<TelemetryMessage, uint8_t, &TelemetryMessage::jitter_ms, 8> {};
+}
+
+/// every page starts with the same 2-byte header
+template <typename... PageFields>
+using TelemetryPageSchema = PackedSchema<TelemetryMessage,
+    TelemetryField::From,
+    TelemetryField::To,
+    TelemetryField::Page,
+    TelemetryField::Emergency,
+    TelemetryField::Enable,
+    TelemetryField::Relay1,
+    TelemetryField::Relay2,
+    PageFields...>;
+
+typedef TelemetryPageSchema<> TelemetryHeader;
+typedef TelemetryPageSchema<TelemetryField::LeftVelocity, TelemetryField::RightVelocity> TelemetryVelocity;
+typedef TelemetryPageSchema<TelemetryField::LeftSteps, TelemetryField::RightSteps> TelemetrySteps;
+typedef TelemetryPageSchema<TelemetryField::LoopMax, TelemetryField::IsrLoad, TelemetryField::Supply> TelemetryHealth;
+typedef TelemetryPageSchema<TelemetryField::Loss, TelemetryField::Errors, TelemetryField::Rtt, TelemetryField::Jitter> TelemetryLink;
+
+static_assert(TelemetryHeader::bits == 16, "telemetry header must stay 2 bytes");
+static_assert(TelemetrySteps::fits(UART_PACKET_SIZE), "telemetry page does not fit in UART_PACKET_SIZE");
+
+// page order by priority: velocities in every other reply
+constexpr TelemetryPage telemetry_rotation[]{
+    TelemetryPage::VELOCITY, TelemetryPage::STEPS,
+    TelemetryPage::VELOCITY, TelemetryPage::HEALTH,
+    TelemetryPage::VELOCITY, TelemetryPage::LINK
+};
+
+/// encode the page selected by message.page
+template <typename Packet>
+void encodeTelemetry(const TelemetryMessage & message, Packet & packet) {
+    switch (message.page) {
+    case TelemetryPage::VELOCITY: TelemetryVelocity::encode(message, packet); break;
+    case TelemetryPage::STEPS: TelemetrySteps::encode(message, packet); break;
+    case TelemetryPage::HEALTH: TelemetryHealth::encode(message, packet); break;
+    case TelemetryPage::LINK: TelemetryLink::encode(message, packet); break;
+    }
+}
+
+/// decode the header, then the page it announces, other fields are left untouched
+template <typename Packet>
+void decodeTelemetry(const Packet & packet, TelemetryMessage & message) {
+    TelemetryHeader::decode(packet, message);
+    switch (message.page) {
+    case TelemetryPage::VELOCITY: TelemetryVelocity::decode(packet, message); break;
+    case TelemetryPage::STEPS: TelemetrySteps::decode(packet, message); break;
+    case TelemetryPage::HEALTH: TelemetryHealth::decode(packet, message); break;
+    case TelemetryPage::LINK: TelemetryLink::decode(packet, message); break;
+    }
+}
+
+/// bytes of a page on air
+inline uint8_t telemetrySize(const TelemetryPage page) {
+    switch (page) {
+    case TelemetryPage::VELOCITY: return TelemetryVelocity::size;
+    case TelemetryPage::STEPS: return TelemetrySteps::size;
+    case TelemetryPage::HEALTH: return TelemetryHealth::size;
+    case TelemetryPage::LINK: return TelemetryLink::size;
+    }
+    return TelemetryHeader::size;
+}
+
+/// telemetry page carried by message type 'type', false if it is no telemetry
+inline bool telemetryPage(const uint8_t type, TelemetryPage & page) {
+    const uint8_t first = uint8_t(MessageType::TELEMETRY);
+    if (type < first || type > first + uint8_t(TelemetryPage::LINK))
+        return false;
+    page = TelemetryPage(type - first);
+    return true;
+}
+
+/*
+* Handler table: incoming packets go to the handler that accepts their
+* message type, decoded straight from the receive queue (AsyncUart::dispatch()):
+*
+*    void onControl(const ControlMessage & command) { ... }
+*    typedef MessageTable<
+*        MessageHandler<MessageType::CONTROL, ControlSchema, ControlMessage, onControl>
+*    > ReceiverMessages;
+*
+*    lora.dispatch<ReceiverMessages>();
+*
+* A handler is any type with accepts(type) and handle(packet), see
+* TelemetryHandler for one covering several types.
+*/
+
+/// one message type decoded with Schema, then passed to 'callback'
+template <MessageType type, typename Schema, typename Message, void (*callback)(const Message &)>
+struct MessageHandler {
+    static constexpr bool accepts(const uint8_t t) {
+        return t == uint8_t(type);
+    }
+
+    /// false if the packet is too short for Schema
+    template <typename Packet>
+    static bool handle(const Packet & packet) {
+        if (packet.length() < Schema::size)
+            return false;
+        Message message;
+        Schema::decode(packet, message);
+        callback(message);
+        return true;
+    }
+};
+
+/// every telemetry page, decoded with decodeTelemetry()
+template <void (*callback)(const TelemetryMessage &)>
+struct TelemetryHandler {
+    static bool accepts(const uint8_t t) {
+        TelemetryPage page;
+        return telemetryPage(t, page);
+    }
+
+    /// false if the packet is too short for its page
+    template <typename Packet>
+    static bool handle(const Packet & packet) {
+        TelemetryPage page;
+        if (packet.length() < TelemetryHeader::size
+            || !telemetryPage(LinkField::type(packet), page)
+            || packet.length() < telemetrySize(page))
+            return false;
+        TelemetryMessage message;
+        decodeTelemetry(packet, message);
+        callback(message);
+        return true;
+    }
+};
+
+template <typename... Handlers>
+struct MessageTable;
+
+template <>
+struct MessageTable<> {
+    template <typename Packet>
+    static inline bool dispatch(const uint8_t, const Packet &) {
+        return false;
+    }
+};
+
+/// first handler accepting 'type' takes the packet, false if none did
+template <typename Head, typename... Rest>
+struct MessageTable<Head, Rest...> {
+    template <typename Packet>
+    static inline bool dispatch(const uint8_t type, const Packet & packet) {
+        if (Head::accepts(type))
+            return Head::handle(packet);
+        return MessageTable<Rest...>::dispatch(type, packet);
+    }
+};
+
+/// one-shot messages on the reliable lane (UART_ARQ): [opcode][arguments]
+enum class LinkCommand : uint8_t {
+    AIR_RATE = 1    // [E32AirRate]: both ends switch to it, see RateNegotiator
+};
+
+// E32 air data rate the modules are flashed with, and the one E32_NEGOTIATE tries to reach
+#ifndef E32_BASE_RATE
+#define E32_BASE_RATE	E32_AIR_2400
+#endif
+
+#ifndef E32_TARGET_RATE
+#define E32_TARGET_RATE	E32_AIR_9600
+#endif
+
+#if defined(E32_NEGOTIATE) && !defined(UART_ARQ)
+#error "E32_NEGOTIATE carries its proposal on the reliable lane, it needs UART_ARQ"
+#endif
+
+#if defined(E32_NEGOTIATE) && defined(UART_TDMA)
+#error "E32_NEGOTIATE switches a single robot, it does not work with UART_TDMA"
+#endif
@@ -9,7 +9,7 @@
 						 if(onSchedule(SCHEDULER_SOURCE, TOKENPASTE2(scheduler_, __LINE__), duration))
 
 // this function already guard timekeeper variable
-static bool onSchedule(const uint32_t current, uint32_t & var, const uint32_t interval) {
+static inline bool onSchedule(const uint32_t current, uint32_t & var, const uint32_t interval) {
 	SCHEDULER_GUARD(current, var);
 	if (current < var + interval) return false;
 
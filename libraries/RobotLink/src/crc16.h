@@ -10,17 +10,33 @@
 
 #include <stdint.h>
 
+#define CRC16_BITWISE		0	// no table, 8 shifts per byte
+#define CRC16_NIBBLE_TABLE	1	// 16 entries (32 bytes), 2 lookups per byte
+#define CRC16_BYTE_TABLE	2	// 256 entries (512 bytes), 1 lookup per byte
+
+// legacy switch, same as CRC16_IMPLEMENTATION CRC16_BYTE_TABLE
 // this feature makes calculation faster, but consumps more flash
 //#define CRC_USE_PRECALCUlATED_TABLE
 
+#ifndef CRC16_IMPLEMENTATION
 #ifdef CRC_USE_PRECALCUlATED_TABLE
+#define CRC16_IMPLEMENTATION CRC16_BYTE_TABLE
+#else
+#define CRC16_IMPLEMENTATION CRC16_NIBBLE_TABLE
+#endif
+#endif
 
 #ifdef ARDUINO_ARCH_AVR
 #include <avr/pgmspace.h>
-const uint16_t CRC16LockupTable[256] PROGMEM = {
+#define CRC16_TABLE_READ(table, index) pgm_read_word_near((table) + (index))
+#define CRC16_TABLE_ATTR PROGMEM
 #else
-const uint16_t CRC16LockupTable[256] = {
+#define CRC16_TABLE_READ(table, index) (table)[index]
+#define CRC16_TABLE_ATTR
 #endif
+
+#if CRC16_IMPLEMENTATION == CRC16_BYTE_TABLE
+static const uint16_t CRC16LookupTable[256] CRC16_TABLE_ATTR = {
 	0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
 	0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
 	0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
@@ -53,35 +69,66 @@ const uint16_t CRC16LockupTable[256] = {
 	0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
 	0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
 	0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040 };
-#endif
 
-static uint16_t calculateCRC16(const uint8_t * data, const uint8_t length) {
-	uint16_t crc = 0xFFFF;
+#elif CRC16_IMPLEMENTATION == CRC16_NIBBLE_TABLE
+static const uint16_t CRC16NibbleTable[16] CRC16_TABLE_ATTR = {
+	0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+	0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400 };
+#endif
 
-#ifdef CRC_USE_PRECALCUlATED_TABLE
-	uint8_t lockupIndex;
+constexpr uint16_t CRC16_INIT = 0xFFFF;
 
-	for (uint8_t i = 0; i < length; ++i) {
-		lookupIndex = data[i] ^ crc;
-		crc >>= 8;
-#ifdef ARDUINO_ARCH_AVR
-		crc ^= pgm_read_word_near(CRC16LockupTable + lookupIndex);
+/// feed one byte into a running CRC
+static inline uint16_t updateCRC16(uint16_t crc, const uint8_t byte) {
+#if CRC16_IMPLEMENTATION == CRC16_BYTE_TABLE
+	return (crc >> 8) ^ CRC16_TABLE_READ(CRC16LookupTable, (uint8_t)(crc ^ byte));
+#elif CRC16_IMPLEMENTATION == CRC16_NIBBLE_TABLE
+	crc = (crc >> 4) ^ CRC16_TABLE_READ(CRC16NibbleTable, (crc ^ byte) & 0x0F);
+	return (crc >> 4) ^ CRC16_TABLE_READ(CRC16NibbleTable, (crc ^ (byte >> 4)) & 0x0F);
 #else
-		crc ^= CRC16LockupTable[lookupIndex];
+	crc ^= (uint16_t)byte;
+	for (int j = 8; j != 0; --j) {
+		if ((crc & 0x0001) != 0) {
+			crc >>= 1;
+			crc ^= 0xA001;
+		} else
+			crc >>= 1;
+	}
+	return crc;
 #endif
+}
+
+/// incremental CRC, feed bytes as they arrive
+class Crc16 {
+public:
+	inline void reset() {
+		m_crc = CRC16_INIT;
 	}
-#else
-	for (uint8_t i = 0; i < length; i++) {
-		crc ^= (uint16_t)data[i];
-		for (int j = 8; j != 0; --j) {
-			if ((crc & 0x0001) != 0) {
-				crc >>= 1;
-				crc ^= 0xA001;
-			} else
-				crc >>= 1;
-		}
+
+	inline void update(const uint8_t byte) {
+		m_crc = updateCRC16(m_crc, byte);
 	}
-#endif
+
+	void update(const uint8_t * data, uint16_t length) {
+		uint16_t crc = m_crc;
+		while (length--)
+			crc = updateCRC16(crc, *data++);
+		m_crc = crc;
+	}
+
+	inline uint16_t value() const {
+		return m_crc;
+	}
+
+private:
+	uint16_t m_crc{ CRC16_INIT };
+};
+
+static inline uint16_t calculateCRC16(const uint8_t * data, const uint8_t length) {
+	uint16_t crc = CRC16_INIT;
+
+	for (uint8_t i = 0; i < length; ++i)
+		crc = updateCRC16(crc, data[i]);
 
 	return crc;
 }
\ No newline at end of file
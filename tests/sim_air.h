@@ -0,0 +1,112 @@
+#pragma once
+
+/*
+* ---sim_air---
+* One LoRa channel shared by E32 modules, for the link simulations:
+*    a packet crosses the sender's UART, waits for its module to be free,
+*    is on air for e32AirtimeUs() and crosses the receiver's UART
+*    two packets from different modules on air at the same time are both lost
+* A packet may carry up to 16 bytes of data (link headers) for the receiver.
+* Stations are numbered like link addresses, the channel does not care who is master.
+* ------------------
+*/
+
+#include <vector>
+#include "Airtime.h"
+
+struct AirPacket {
+	uint8_t from;
+	uint8_t to;
+	uint8_t bytes;
+	uint8_t data[16];
+	uint32_t air_start_us;
+	uint32_t air_end_us;
+	uint32_t deliver_us;
+	bool lost;
+};
+
+class SimAir {
+public:
+	SimAir(const uint32_t air_rate, const uint32_t serial_baud)
+		: m_air_rate(air_rate),
+		m_serial_baud(serial_baud) {
+		memset(m_module_free_us, 0, sizeof(m_module_free_us));
+	}
+
+	/// station 'from' writes 'bytes' to its module at 'now_us', the module adds 'latency_us'
+	void send(const uint8_t from, const uint8_t to, const uint8_t bytes, const uint32_t now_us,
+		const uint32_t latency_us, const uint8_t * data = nullptr, const uint8_t data_length = 0) {
+		const uint32_t serial_us = uartAirtimeUs(bytes, m_serial_baud * 8 / 10);
+		AirPacket packet;
+		packet.from = from;
+		packet.to = to;
+		packet.bytes = bytes;
+		memset(packet.data, 0, sizeof(packet.data));
+		if (data != nullptr)
+			memcpy(packet.data, data, data_length < sizeof(packet.data) ? data_length : sizeof(packet.data));
+		packet.air_start_us = now_us + serial_us + latency_us;
+		if (packet.air_start_us < m_module_free_us[from])
+			packet.air_start_us = m_module_free_us[from];
+		packet.air_end_us = packet.air_start_us + e32AirtimeUs(bytes, m_air_rate);
+		packet.deliver_us = packet.air_end_us + serial_us;
+		packet.lost = false;
+		m_module_free_us[from] = packet.air_end_us;
+		m_pending.push_back(packet);
+		m_sent++;
+	}
+
+	/// next packet whose last byte left the receiving module by 'now_us', false if none;
+	/// a lost packet is returned too, with 'lost' set
+	bool receive(const uint32_t now_us, AirPacket & packet) {
+		for (size_t i = 0; i < m_pending.size(); ++i) {
+			if (m_pending[i].deliver_us > now_us)
+				continue;
+			packet = m_pending[i];
+			// everything that overlaps it has started by now
+			for (size_t j = 0; j < m_on_air.size(); ++j)
+				packet.lost = packet.lost || overlaps(packet, m_on_air[j]);
+			for (size_t j = 0; j < m_pending.size(); ++j)
+				packet.lost = packet.lost || (j != i && overlaps(packet, m_pending[j]));
+			if (packet.lost)
+				m_collided++;
+			m_on_air.push_back(m_pending[i]);
+			m_pending.erase(m_pending.begin() + i);
+			forget(now_us);
+			return true;
+		}
+		return false;
+	}
+
+	/// packets handed to the modules
+	inline uint32_t sent() const {
+		return m_sent;
+	}
+
+	/// packets lost to another packet on air
+	inline uint32_t collided() const {
+		return m_collided;
+	}
+
+	inline float collisionPercent() const {
+		return m_sent > 0 ? 100.0f * m_collided / m_sent : 0.0f;
+	}
+
+private:
+	static bool overlaps(const AirPacket & a, const AirPacket & b) {
+		return a.from != b.from && a.air_start_us < b.air_end_us && b.air_start_us < a.air_end_us;
+	}
+
+	/// delivered packets long off the air cannot overlap anything still coming
+	void forget(const uint32_t now_us) {
+		while (!m_on_air.empty() && m_on_air.front().air_end_us + 2000000UL < now_us)
+			m_on_air.erase(m_on_air.begin());
+	}
+
+	const uint32_t m_air_rate;
+	const uint32_t m_serial_baud;
+	uint32_t m_module_free_us[16];
+	std::vector<AirPacket> m_pending;
+	std::vector<AirPacket> m_on_air;
+	uint32_t m_sent{ 0 };
+	uint32_t m_collided{ 0 };
+};
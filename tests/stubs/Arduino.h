@@ -0,0 +1,88 @@
+#pragma once
+
+/*
+* ---Arduino stub---
+* Just enough of the Arduino / libmaple API to compile the RobotLink headers
+* on a host. Time is simulated: tests move host_us forward themselves.
+* ------------------
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int32_t int32;
+typedef int16_t int16;
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+#define HIGH 1
+#define LOW 0
+enum WiringPinMode { OUTPUT, INPUT, INPUT_PULLUP };
+
+extern uint32_t host_us;
+inline uint32_t micros() { return host_us; }
+inline uint32_t millis() { return host_us / 1000; }
+inline void delay(const uint32_t ms) { host_us += ms * 1000; }
+inline void delayMicroseconds(const uint32_t us) { host_us += us; }
+
+// pin levels, a test (or a simulated peripheral on another thread) may read and drive them
+extern volatile uint8_t host_pin[256];
+inline void pinMode(uint8_t, WiringPinMode) {}
+inline void digitalWrite(const uint8_t pin, const uint8_t value) { host_pin[pin] = value; }
+inline uint8_t digitalRead(const uint8_t pin) { return host_pin[pin]; }
+inline uint16_t analogRead(uint8_t) { return 0; }
+
+#define interrupts()
+#define noInterrupts()
+
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t) = 0;
+	virtual size_t write(const uint8_t * buffer, size_t size) {
+		for (size_t i = 0; i < size; ++i)
+			write(buffer[i]);
+		return size;
+	}
+	size_t print(const char * s) { return write((const uint8_t *)s, strlen(s)); }
+	size_t print(const __FlashStringHelper * s) { return print((const char *)s); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(int v) { char b[16]; snprintf(b, sizeof(b), "%d", v); return print(b); }
+	size_t print(long v) { char b[24]; snprintf(b, sizeof(b), "%ld", v); return print(b); }
+	size_t print(unsigned int v) { char b[16]; snprintf(b, sizeof(b), "%u", v); return print(b); }
+	size_t print(unsigned long v) { char b[24]; snprintf(b, sizeof(b), "%lu", v); return print(b); }
+	size_t print(double v) { char b[32]; snprintf(b, sizeof(b), "%f", v); return print(b); }
+	size_t println(const char * s) { return print(s) + print("\r\n"); }
+};
+
+class Stream : public Print {
+public:
+	virtual int available() { return 0; }
+	virtual int read() { return -1; }
+	virtual int peek() { return -1; }
+	virtual void flush() {}
+	void setTimeout(uint32_t) {}
+};
+
+/// output goes to stdout, so a test can show what the sketch would print
+class USBSerial : public Stream {
+public:
+	void begin(uint32_t) {}
+	size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+	size_t write(const uint8_t * buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+	operator bool() { return true; }
+};
+
+extern USBSerial Serial;
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
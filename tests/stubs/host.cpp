@@ -0,0 +1,5 @@
+#include "Arduino.h"
+
+uint32_t host_us = 0;
+volatile uint8_t host_pin[256];
+USBSerial Serial;
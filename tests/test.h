@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+* ---test---
+* Minimal host test harness, no framework needed:
+*    CHECK(cond) / CHECK_EQ(a, b) count failures and print where they happened,
+*    main() ends with return TEST_RESULT();
+* BENCH_NS(rounds, body) times 'body' with the host clock, for relative numbers
+* only; cycles on the Cortex-M3 still have to be measured on the target.
+* ------------------
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int test_checks = 0;
+static int test_failures = 0;
+
+#define CHECK(cond) do { test_checks++; if (!(cond)) { test_failures++; \
+	printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } } while (0)
+
+#define CHECK_EQ(a, b) do { test_checks++; const long long _a = (long long)(a), _b = (long long)(b); \
+	if (_a != _b) { test_failures++; \
+	printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); } } while (0)
+
+#define TEST_RESULT() (printf("%s: %d checks, %d failed\n", __FILE__, test_checks, test_failures), test_failures != 0)
+
+static inline double hostNs() {
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/// average ns per round of 'body'
+#define BENCH_NS(rounds, body) ({ const double _start = hostNs(); \
+	for (uint32_t _round = 0; _round < (rounds); ++_round) { body; } \
+	(hostNs() - _start) / (rounds); })
+
+/// benchmarks run only with --bench (make bench), plain runs stay quick
+static inline bool benchRequested(const int argc, char ** argv) {
+	return argc > 1 && strcmp(argv[1], "--bench") == 0;
+}
+
+/// keeps the compiler from optimizing a benchmarked result away
+template <typename T>
+static inline void benchKeep(const T & value) {
+	__asm__ volatile("" : : "g"(&value) : "memory");
+}
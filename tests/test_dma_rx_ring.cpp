@@ -0,0 +1,215 @@
+/*
+* DmaRxRing driven by a simulated circular DMA channel: bytes land in the ring
+* the way the channel writes them, onIdle() gets the remaining transfer count
+* (CNDTR) as the USART idle interrupt would see it. Packets split the way
+* AsyncUart splits them (length byte + 3), also when IDLE is read late and
+* the snapshot lands in the middle of a packet.
+*/
+
+#include "test.h"
+#include "DmaRxRing.h"
+
+template <typename Ring>
+class SimDma {
+public:
+	SimDma(Ring & ring)
+		: m_ring(ring) {
+	}
+
+	void receive(const uint8_t * data, const uint16_t length) {
+		for (uint16_t i = 0; i < length; ++i) {
+			m_ring.buffer()[m_position] = data[i];
+			m_position = (m_position + 1) % m_ring.capacity();
+		}
+	}
+
+	/// line went idle, CNDTR counts down from the buffer size and reloads at 0
+	void idle() {
+		m_ring.onIdle(m_ring.capacity() - m_position);
+	}
+
+private:
+	Ring & m_ring;
+	uint16_t m_position{ 0 };
+};
+
+static bool frameIs(const DmaRxRing<64, 4> & ring, const uint8_t * expected, const uint16_t length) {
+	const auto & frame = ring.peek();
+	if (frame.length != length)
+		return false;
+	uint8_t copy[64];
+	ring.copy(frame, 0, copy, length);
+	for (uint16_t i = 0; i < length; ++i)
+		if (ring.at(frame, i) != expected[i] || copy[i] != expected[i])
+			return false;
+	return true;
+}
+
+static void testSingleFrame() {
+	DmaRxRing<64, 4> ring;
+	SimDma<DmaRxRing<64, 4>> dma(ring);
+	const uint8_t packet[] = { 5, 1, 2, 3, 4, 5, 0xAB, 0xCD };
+
+	dma.idle();
+	CHECK(!ring.available());
+
+	dma.receive(packet, sizeof(packet));
+	dma.idle();
+	CHECK(ring.available());
+	CHECK(frameIs(ring, packet, sizeof(packet)));
+	CHECK(ring.contiguous(ring.peek()) != nullptr);
+	ring.pop();
+	CHECK(!ring.available());
+
+	// idle again without new bytes, nothing new
+	dma.idle();
+	CHECK(!ring.available());
+}
+
+static void testWrapAround() {
+	DmaRxRing<64, 4> ring;
+	SimDma<DmaRxRing<64, 4>> dma(ring);
+	uint8_t filler[60];
+	for (uint8_t i = 0; i < sizeof(filler); ++i)
+		filler[i] = i;
+	dma.receive(filler, sizeof(filler));
+	dma.idle();
+	ring.pop();
+
+	uint8_t packet[10];
+	for (uint8_t i = 0; i < sizeof(packet); ++i)
+		packet[i] = 0xF0 + i;
+	dma.receive(packet, sizeof(packet));
+	dma.idle();
+	CHECK(ring.available());
+	CHECK_EQ(ring.peek().offset, 60);
+	CHECK(frameIs(ring, packet, sizeof(packet)));
+	CHECK(ring.contiguous(ring.peek()) == nullptr);
+
+	// partial copy from the middle, across the end of the ring
+	uint8_t part[6];
+	ring.copy(ring.peek(), 2, part, sizeof(part));
+	CHECK(memcmp(part, packet + 2, sizeof(part)) == 0);
+
+	// copy past the end of the frame is cut to the frame
+	memset(part, 0, sizeof(part));
+	ring.copy(ring.peek(), 8, part, sizeof(part));
+	CHECK_EQ(part[0], packet[8]);
+	CHECK_EQ(part[1], packet[9]);
+	CHECK_EQ(part[2], 0);
+}
+
+static void testDroppedFrames() {
+	DmaRxRing<64, 4> ring;
+	SimDma<DmaRxRing<64, 4>> dma(ring);
+	const uint8_t packet[] = { 1, 2, 3 };
+	for (uint8_t i = 0; i < 6; ++i) {
+		dma.receive(packet, sizeof(packet));
+		dma.idle();
+	}
+	CHECK_EQ(ring.droppedFrames(), 2);
+	uint8_t frames = 0;
+	while (ring.available()) {
+		CHECK(frameIs(ring, packet, sizeof(packet)));
+		ring.pop();
+		frames++;
+	}
+	CHECK_EQ(frames, 4);
+}
+
+/// random bursts, consumed in random batches, contents must come out in order
+static void testRandomBursts() {
+	DmaRxRing<64, 4> ring;
+	SimDma<DmaRxRing<64, 4>> dma(ring);
+	srand(26);
+	uint8_t sent[4][32];
+	uint8_t sent_length[4];
+	uint8_t pending = 0;
+	uint8_t next = 0;
+	uint32_t frames = 0;
+
+	for (uint32_t round = 0; round < 5000; ++round) {
+		// never more than the ring holds between two reads, see the note in DmaRxRing.h
+		if (pending < 2) {
+			const uint8_t length = 1 + rand() % 31;
+			uint8_t * data = sent[(next + pending) % 4];
+			for (uint8_t i = 0; i < length; ++i)
+				data[i] = rand();
+			sent_length[(next + pending) % 4] = length;
+			dma.receive(data, length);
+			dma.idle();
+			pending++;
+		}
+		if (rand() % 2) {
+			while (ring.available()) {
+				CHECK(frameIs(ring, sent[next], sent_length[next]));
+				ring.pop();
+				next = (next + 1) % 4;
+				pending--;
+				frames++;
+			}
+		}
+	}
+	CHECK(frames > 1000);
+	CHECK_EQ(ring.droppedFrames(), 0);
+}
+
+/// AsyncUart's split of a frame into length + 3 byte packets, an incomplete last packet stays in the ring
+static uint8_t splitPackets(DmaRxRing<64, 4> & ring, uint8_t * lengths) {
+	uint8_t packets = 0;
+	while (ring.available()) {
+		const auto & frame = ring.peek();
+		uint16_t i = 0;
+		while (i < frame.length && i + ring.at(frame, i) + 3 <= frame.length) {
+			lengths[packets++] = ring.at(frame, i) + 3;
+			i += ring.at(frame, i) + 3;
+		}
+		ring.pop(i);
+	}
+	return packets;
+}
+
+static void testIdleMidPacket() {
+	DmaRxRing<64, 4> ring;
+	SimDma<DmaRxRing<64, 4>> dma(ring);
+	uint8_t a[13] = { 10 }, b[9] = { 6 }, c[5] = { 2 };
+	uint8_t lengths[8];
+
+	// A, then IDLE read while B is coming in
+	dma.receive(a, sizeof(a));
+	dma.receive(b, 4);
+	dma.idle();
+	CHECK_EQ(splitPackets(ring, lengths), 1);
+	CHECK_EQ(lengths[0], sizeof(a));
+	CHECK(!ring.available());
+
+	// the rest of B and all of C: B comes out whole
+	dma.receive(b + 4, sizeof(b) - 4);
+	dma.receive(c, sizeof(c));
+	dma.idle();
+	CHECK_EQ(ring.peek().length, sizeof(b) + sizeof(c));
+	CHECK_EQ(splitPackets(ring, lengths), 2);
+	CHECK_EQ(lengths[0], sizeof(b));
+	CHECK_EQ(lengths[1], sizeof(c));
+
+	// cut again with the next frame already queued: the rest goes in front of it
+	for (uint8_t round = 0; round < 10; ++round) {
+		dma.receive(a, 7);
+		dma.idle();
+		dma.receive(a + 7, sizeof(a) - 7);
+		dma.idle();
+		CHECK_EQ(splitPackets(ring, lengths), 1);
+		CHECK_EQ(lengths[0], sizeof(a));
+	}
+	CHECK(!ring.available());
+	CHECK_EQ(ring.droppedFrames(), 0);
+}
+
+int main() {
+	testSingleFrame();
+	testWrapAround();
+	testDroppedFrames();
+	testRandomBursts();
+	testIdleMidPacket();
+	return TEST_RESULT();
+}
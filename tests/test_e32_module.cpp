@@ -0,0 +1,238 @@
+/*
+* E32Module against a simulated module on a Linux pty: the driver talks to the
+* slave end like to Serial1, a thread on the master end answers the way an E32
+* does while M0 and M1 are high and the port runs at 9600.
+* The non-blocking air rate change must never advance the (simulated) clock
+* inside run(), so loop() and the watchdog keep going while it runs.
+*/
+
+// before Arduino.h, whose min / max macros break <limits>
+#include <atomic>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "test.h"
+#include "Arduino.h"
+#include "E32Module.h"
+
+static const uint8_t pin_m0 = 10;
+static const uint8_t pin_m1 = 11;
+static const uint8_t pin_aux = 12;
+static const uint32_t sketch_baud = 57600;
+
+/// the slave end of the pty as a HardwareSerial
+class PtyPort {
+public:
+	explicit PtyPort(const int fd)
+		: m_fd(fd) {
+	}
+
+	void begin(const uint32_t baud) {
+		termios tio;
+		tcgetattr(m_fd, &tio);
+		cfmakeraw(&tio);
+		tcsetattr(m_fd, TCSANOW, &tio);
+		baudrate = baud;
+	}
+
+	size_t write(const uint8_t * data, const size_t length) {
+		return ::write(m_fd, data, length);
+	}
+
+	int available() {
+		int count = 0;
+		ioctl(m_fd, FIONREAD, &count);
+		return count;
+	}
+
+	int read() {
+		uint8_t byte;
+		return ::read(m_fd, &byte, 1) == 1 ? byte : -1;
+	}
+
+	void flush() {
+		tcdrain(m_fd);
+	}
+
+	std::atomic<uint32_t> baudrate{ 0 };
+
+private:
+	const int m_fd;
+};
+
+/// an E32 on the master end of the pty: answers C1 C1 C1, takes C0 / C2 + 5 bytes
+class SimModule {
+public:
+	SimModule(const int fd, const PtyPort & port)
+		: m_fd(fd),
+		m_port(port) {
+	}
+
+	void start() {
+		m_thread = std::thread([this]() { serve(); });
+	}
+
+	void stop() {
+		m_stop = true;
+		m_thread.join();
+	}
+
+	uint8_t params[6] = { 0xC0, 0x00, 0x00, 0x1A, 0x17, 0x44 };
+	std::atomic<bool> mute{ false };
+	std::atomic<uint16_t> writes{ 0 };
+	std::atomic<uint16_t> saves{ 0 };
+
+private:
+	void serve() {
+		uint8_t command[6];
+		uint8_t length = 0;
+		while (!m_stop) {
+			pollfd p = { m_fd, POLLIN, 0 };
+			if (poll(&p, 1, 1) <= 0)
+				continue;
+			uint8_t byte;
+			if (::read(m_fd, &byte, 1) != 1)
+				continue;
+			// normal mode, or a baud rate it cannot read: the byte goes on air or is garbage
+			if (host_pin[pin_m0] != HIGH || host_pin[pin_m1] != HIGH || m_port.baudrate != 9600 || mute) {
+				length = 0;
+				continue;
+			}
+			command[length++] = byte;
+			if (length == 3 && command[0] == 0xC1 && command[1] == 0xC1 && command[2] == 0xC1) {
+				answer(params);
+				length = 0;
+			}
+			else if (length == 6 && (command[0] == 0xC0 || command[0] == 0xC2)) {
+				memcpy(params + 1, command + 1, 5);
+				writes++;
+				if (command[0] == 0xC0)
+					saves++;
+				answer(params);
+				length = 0;
+			}
+			else if (length == 6 || (command[0] != 0xC0 && command[0] != 0xC1 && command[0] != 0xC2))
+				length = 0;
+		}
+	}
+
+	void answer(const uint8_t * data) {
+		if (::write(m_fd, data, 6) != 6)
+			perror("pty");
+	}
+
+	const int m_fd;
+	const PtyPort & m_port;
+	std::thread m_thread;
+	std::atomic<bool> m_stop{ false };
+};
+
+struct Run {
+	E32Module<PtyPort>::Job result;
+	uint32_t duration_ms;
+	bool never_waited;
+};
+
+/// run() once per simulated millisecond, as loop() would, until the change ends
+static Run drive(E32Module<PtyPort> & radio) {
+	Run run = { E32Module<PtyPort>::Job::BUSY, 0, true };
+	const uint32_t start_us = host_us;
+	while (run.result == E32Module<PtyPort>::Job::BUSY && host_us - start_us < 5000000UL) {
+		const uint32_t before_us = host_us;
+		run.result = radio.run();
+		run.never_waited = run.never_waited && host_us == before_us;
+		host_us += 1000;
+		// the module on the other thread gets real time to answer
+		usleep(200);
+	}
+	run.duration_ms = (host_us - start_us) / 1000;
+	return run;
+}
+
+int main(int argc, char ** argv) {
+	benchRequested(argc, argv);
+
+	const int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+		perror("pty");
+		return 1;
+	}
+	termios tio;
+	tcgetattr(master, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(master, TCSANOW, &tio);
+	const int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+	CHECK(slave >= 0);
+
+	PtyPort port(slave);
+	SimModule module(master, port);
+	module.start();
+	E32Module<PtyPort> radio(&port, pin_m0, pin_m1, sketch_baud);
+	radio.begin();
+	port.begin(sketch_baud);
+
+	// setup(): the blocking calls, before the watchdog runs
+	E32Config config;
+	CHECK(radio.readConfig(config));
+	CHECK_EQ(config.airRate(), E32_AIR_2400);
+	CHECK_EQ(E32Config::uartBps(config.uartBaud()), 9600);
+	CHECK(config.fec());
+	CHECK_EQ(port.baudrate, sketch_baud);
+	CHECK_EQ(host_pin[pin_m0], LOW);
+
+	// loop(): the air rate changes without run() ever waiting
+	CHECK(radio.startAirRate(E32_AIR_9600));
+	CHECK(radio.busy());
+	CHECK(!radio.startAirRate(E32_AIR_4800));
+	Run run = drive(radio);
+	CHECK(run.result == E32Module<PtyPort>::Job::DONE);
+	CHECK(run.never_waited);
+	CHECK(!radio.busy());
+	CHECK_EQ(module.params[3] & 0x07, E32_AIR_9600);
+	// only the rate changed, not saved to the module's flash
+	CHECK_EQ(module.params[3] & ~0x07, 0x1A & ~0x07);
+	CHECK_EQ(module.params[5], 0x44);
+	CHECK_EQ(module.writes, 1);
+	CHECK_EQ(module.saves, 0);
+	CHECK_EQ(port.baudrate, sketch_baud);
+	CHECK_EQ(host_pin[pin_m0], LOW);
+	CHECK_EQ(host_pin[pin_m1], LOW);
+	CHECK(radio.run() == E32Module<PtyPort>::Job::IDLE);
+	printf("air rate change: %lu ms of loop() time, never blocking\n", (unsigned long)run.duration_ms);
+
+	// already at that rate: read, nothing written
+	CHECK(radio.startAirRate(E32_AIR_9600));
+	run = drive(radio);
+	CHECK(run.result == E32Module<PtyPort>::Job::DONE);
+	CHECK_EQ(module.writes, 1);
+
+	// a module that does not answer: FAILED after the timeout, back in normal mode
+	module.mute = true;
+	CHECK(radio.startAirRate(E32_AIR_2400));
+	run = drive(radio);
+	CHECK(run.result == E32Module<PtyPort>::Job::FAILED);
+	CHECK(run.never_waited);
+	CHECK(run.duration_ms >= E32_TIMEOUT_MS);
+	CHECK_EQ(port.baudrate, sketch_baud);
+	CHECK_EQ(host_pin[pin_m0], LOW);
+	module.mute = false;
+
+	// with AUX: ready 2 ms after it reads high
+	E32Module<PtyPort> radio_aux(&port, pin_m0, pin_m1, sketch_baud, pin_aux);
+	host_pin[pin_aux] = HIGH;
+	CHECK(radio_aux.startAirRate(E32_AIR_2400, true));
+	run = drive(radio_aux);
+	CHECK(run.result == E32Module<PtyPort>::Job::DONE);
+	CHECK(run.duration_ms < 2 * E32_MODE_DELAY_MS);
+	CHECK_EQ(module.params[3] & 0x07, E32_AIR_2400);
+	CHECK_EQ(module.saves, 1);
+
+	module.stop();
+	close(slave);
+	close(master);
+	return TEST_RESULT();
+}
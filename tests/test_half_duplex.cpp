@@ -0,0 +1,130 @@
+/*
+* Half-duplex turn-taking on a simulated E32 channel at 2.4k: the Controller
+* commands every 100 ms and one robot answers.
+*    free running   the robot reports every 500 ms on its own clock (before UART_HALF_DUPLEX)
+*    data rate turn the master's turn sized by bytes / air rate, as first written
+*    airtime turn   the turn sized by turnAirtimeUs(), as AsyncUart does now
+* Prints the collision rate of each, --bench adds nothing.
+*/
+
+#include "test.h"
+#include "RobotProtocol.h"
+#include "sim_air.h"
+
+// AsyncUart defaults
+static const uint32_t air_rate = 2400;
+static const uint32_t module_baud = 9600;
+static const uint32_t reply_window_us = 20000;
+static const uint32_t guard_us = 10000;
+
+static const uint8_t command_bytes = ControlSchema::size + 3;
+static const uint8_t reply_bytes = TelemetrySteps::size + 3;
+static const uint32_t command_interval_us = 100000;
+static const uint32_t step_us = 100;
+static const uint32_t run_us = 120000000UL;
+
+enum class Mode {
+	FREE_RUNNING,
+	DATA_RATE_TURN,
+	AIRTIME_TURN
+};
+
+struct Result {
+	float collision_percent;
+	uint32_t commands;
+	uint32_t replies;
+};
+
+/// module latency on top of the UART, up to half the guard
+static uint32_t latencyUs() {
+	return rand() % (guard_us / 2);
+}
+
+static Result simulate(const Mode mode) {
+	SimAir air(air_rate, module_baud);
+	const uint8_t controller = controller_id;
+	const uint8_t robot = robot_id;
+
+	uint32_t turn_us = turnAirtimeUs(command_bytes, reply_bytes, air_rate, module_baud, reply_window_us, guard_us);
+	if (mode == Mode::DATA_RATE_TURN)
+		turn_us = uartAirtimeUs(command_bytes, air_rate) + reply_window_us
+			+ uartAirtimeUs(reply_bytes, air_rate) + 2 * guard_us;
+
+	Result result = {};
+	uint32_t last_command_us = 0;
+	bool waiting_reply = false;
+	uint32_t turn_start_us = 0;
+	uint32_t reply_due_us = 0;
+	bool reply_pending = false;
+	uint32_t last_report_us = 0;
+
+	for (uint32_t now = 0; now < run_us; now += step_us) {
+		AirPacket packet;
+		while (air.receive(now, packet)) {
+			if (packet.lost)
+				continue;
+			if (packet.to == robot && mode != Mode::FREE_RUNNING) {
+				// answered from the robot's loop, inside the reply window
+				reply_due_us = now + 500 + rand() % (reply_window_us / 2);
+				reply_pending = true;
+			}
+			if (packet.to == controller) {
+				result.replies++;
+				waiting_reply = false;
+			}
+		}
+
+		// Controller
+		if (waiting_reply && now - turn_start_us >= turn_us)
+			waiting_reply = false;
+		if (!waiting_reply && now - last_command_us >= command_interval_us) {
+			air.send(controller, robot, command_bytes, now, latencyUs());
+			result.commands++;
+			last_command_us = now;
+			if (mode != Mode::FREE_RUNNING) {
+				waiting_reply = true;
+				turn_start_us = now;
+			}
+		}
+
+		// robot
+		if (mode == Mode::FREE_RUNNING && now - last_report_us >= 500000) {
+			air.send(robot, controller, reply_bytes, now, latencyUs());
+			last_report_us = now;
+		}
+		if (reply_pending && now >= reply_due_us) {
+			air.send(robot, controller, reply_bytes, now, latencyUs());
+			reply_pending = false;
+		}
+	}
+	result.collision_percent = air.collisionPercent();
+	return result;
+}
+
+int main(int argc, char ** argv) {
+	benchRequested(argc, argv);
+	srand(38);
+
+	// the turn covers both packets on air, the data rate alone is a fraction of it
+	CHECK(e32AirtimeUs(10, air_rate) > 120000 && e32AirtimeUs(10, air_rate) < 130000);
+	CHECK(turnAirtimeUs(command_bytes, reply_bytes, air_rate, module_baud, reply_window_us, guard_us)
+		> e32AirtimeUs(command_bytes, air_rate) + e32AirtimeUs(reply_bytes, air_rate) + reply_window_us);
+
+	const Result free_running = simulate(Mode::FREE_RUNNING);
+	const Result data_rate = simulate(Mode::DATA_RATE_TURN);
+	const Result airtime = simulate(Mode::AIRTIME_TURN);
+	printf("collisions at %lu bps, %u + %u bytes: free running %.1f%%, data rate turn %.1f%%, airtime turn %.1f%%\n",
+		(unsigned long)air_rate, command_bytes, reply_bytes,
+		free_running.collision_percent, data_rate.collision_percent, airtime.collision_percent);
+	printf("airtime turn: %u commands, %u replies in %lu s\n",
+		airtime.commands, airtime.replies, (unsigned long)(run_us / 1000000UL));
+
+	CHECK(free_running.collision_percent > 5.0f);
+	CHECK(data_rate.collision_percent > 5.0f);
+	CHECK(airtime.collision_percent == 0.0f);
+	// every command answered, one turn after the other
+	CHECK(airtime.replies + 1 >= airtime.commands);
+	CHECK(airtime.commands > run_us / turnAirtimeUs(command_bytes, reply_bytes, air_rate, module_baud,
+		reply_window_us, guard_us));
+	return TEST_RESULT();
+}
@@ -0,0 +1,105 @@
+/*
+* ReedSolomon: the flash tables match GF(256) with polynomial 0x11D, clean
+* codewords decode untouched, up to paritySize / 2 wrong bytes anywhere are
+* corrected, more are refused or at least never reported as fewer.
+* --bench prints ns per encode + decode of a raw control frame, clean and with errors.
+*/
+
+#include "test.h"
+#include "ReedSolomon.h"
+
+static void tables() {
+	uint16_t x = 1;
+	bool exp_ok = true, log_ok = true;
+	for (uint16_t i = 0; i < 255; ++i) {
+		exp_ok = exp_ok && ReedSolomonExp[i] == x && ReedSolomonExp[i + 255] == x;
+		log_ok = log_ok && ReedSolomonLog[x] == i;
+		x <<= 1;
+		if (x & 0x100)
+			x ^= 0x11D;
+	}
+	CHECK(exp_ok);
+	CHECK(log_ok);
+	CHECK_EQ(ReedSolomonExp[510], ReedSolomonExp[0]);
+}
+
+/// 'errors' distinct positions of 'codeword' changed to a different value
+static void damage(uint8_t * codeword, const uint8_t length, const uint8_t errors) {
+	bool hit[255] = {};
+	for (uint8_t e = 0; e < errors; ++e) {
+		uint8_t position;
+		do
+			position = rand() % length;
+		while (hit[position]);
+		hit[position] = true;
+		codeword[position] ^= 1 + rand() % 255;
+	}
+}
+
+template <uint8_t parity>
+static void roundTrip(const uint8_t length) {
+	ReedSolomon<parity> rs;
+	uint8_t data[255], codeword[255];
+	bool corrected = true, clean = true, refused = true;
+	uint16_t refusals = 0;
+	const uint16_t rounds = 500;
+	for (uint16_t round = 0; round < rounds; ++round) {
+		for (uint8_t i = 0; i < length; ++i)
+			data[i] = rand();
+		memcpy(codeword, data, length);
+		rs.encode(codeword, length);
+
+		uint8_t copy[255];
+		memcpy(copy, codeword, length + parity);
+		clean = clean && rs.decode(copy, length + parity) == 0 && memcmp(copy, codeword, length + parity) == 0;
+
+		const uint8_t errors = 1 + rand() % (parity / 2);
+		memcpy(copy, codeword, length + parity);
+		damage(copy, length + parity, errors);
+		corrected = corrected && rs.decode(copy, length + parity) == errors
+			&& memcmp(copy, codeword, length + parity) == 0;
+
+		// beyond the capacity: refused, or miscorrected into another codeword with more than t errors
+		memcpy(copy, codeword, length + parity);
+		damage(copy, length + parity, parity / 2 + 1);
+		const int8_t result = rs.decode(copy, length + parity);
+		if (result < 0)
+			refusals++;
+		else
+			refused = refused && memcmp(copy, codeword, length + parity) != 0;
+	}
+	CHECK(clean);
+	CHECK(corrected);
+	CHECK(refused);
+	CHECK(refusals > rounds / 2);
+}
+
+int main(int argc, char ** argv) {
+	srand(41);
+	tables();
+	roundTrip<2>(8);
+	roundTrip<4>(10);
+	roundTrip<4>(60);
+	roundTrip<8>(40);
+	roundTrip<16>(200);
+
+	if (benchRequested(argc, argv)) {
+		ReedSolomon<4> rs;
+		uint8_t frame[10 + 4] = { 7, 0x11, 0x20, 1, 2, 3, 4, 5, 0xAB, 0xCD };
+		const double clean_ns = BENCH_NS(1000000, {
+			frame[3] = _round;
+			rs.encode(frame, 10);
+			benchKeep(rs.decode(frame, sizeof(frame)));
+		});
+		const double errors_ns = BENCH_NS(1000000, {
+			frame[3] = _round;
+			rs.encode(frame, 10);
+			frame[2] ^= 0x5A;
+			frame[9] ^= 0x01;
+			benchKeep(rs.decode(frame, sizeof(frame)));
+		});
+		printf("RS(14,10): %.1f ns clean, %.1f ns with 2 errors per encode + decode on this host\n",
+			clean_ns, errors_ns);
+	}
+	return TEST_RESULT();
+}
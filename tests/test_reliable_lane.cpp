@@ -0,0 +1,88 @@
+/*
+* ReliableLane: messages are delivered once through lost acks, a sender
+* rebooted inside the retry window gets its first message through, and
+* attach() never writes more than the room it was given.
+*/
+
+#include "test.h"
+#include "ReliableLane.h"
+
+static const uint8_t controller = 1;
+static const uint8_t robot = 2;
+
+/// one packet from 'sender' to 'receiver' carrying only the lane trailer
+static int16_t carry(ReliableLane<> & sender, const uint8_t from, ReliableLane<> & receiver, const uint8_t to,
+	const uint32_t now_ms) {
+	uint8_t packet[32];
+	const uint8_t used = sender.attach(packet, sizeof(packet), to, now_ms);
+	return receiver.detach(packet, used, from, now_ms);
+}
+
+static void deliveredOnce() {
+	ReliableLane<> controller_lane, robot_lane;
+	const uint8_t rate[] = { 'R', 3 };
+	CHECK(controller_lane.send(robot, rate, sizeof(rate)));
+
+	// the ack is lost twice: the robot sees three copies, delivers one
+	uint32_t now = 0;
+	for (uint8_t copy = 0; copy < 3; ++copy, now += ARQ_RETRY_MAX_MS)
+		CHECK(carry(controller_lane, controller, robot_lane, robot, now) > 0);
+	CHECK(robot_lane.available());
+	robot_lane.pop();
+	CHECK(!robot_lane.available());
+	CHECK_EQ(robot_lane.duplicates(), 2);
+
+	carry(robot_lane, robot, controller_lane, controller, now);
+	CHECK_EQ(controller_lane.pending(), 0);
+}
+
+static void rebootedSender() {
+	const uint8_t rate[] = { 'R', 3 };
+	const uint8_t back[] = { 'R', 2 };
+	uint16_t delivered = 0;
+	const uint16_t boots = 256;
+	for (uint16_t boot = 0; boot < boots; ++boot) {
+		ReliableLane<> robot_lane;
+		ReliableLane<> before;
+		before.seed(rand() * 2654435761UL);
+		before.send(robot, rate, sizeof(rate));
+		carry(before, controller, robot_lane, robot, 1000);
+		robot_lane.pop();
+
+		// rebooted one second later, well inside the retry window, with a different message
+		ReliableLane<> after;
+		after.seed(rand() * 2654435761UL);
+		after.send(robot, back, sizeof(back));
+		carry(after, controller, robot_lane, robot, 2000);
+		if (robot_lane.available() && robot_lane.peek().data[1] == 2)
+			delivered++;
+	}
+	CHECK_EQ(delivered, boots);
+}
+
+static void roomRespected() {
+	ReliableLane<> lane, other;
+	const uint8_t message[ARQ_MAX_MESSAGE] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	lane.send(robot, message, sizeof(message));
+
+	uint8_t packet[32];
+	memset(packet, 0xEE, sizeof(packet));
+	CHECK_EQ(lane.attach(packet, 0, robot, 0), 0);
+	// no room for the message: descriptor only, the message waits
+	CHECK_EQ(lane.attach(packet, ReliableLane<>::messageOverhead, robot, 0), ReliableLane<>::overhead);
+	CHECK_EQ(packet[1], 0xEE);
+	const uint8_t used = lane.attach(packet, ReliableLane<>::overhead + ReliableLane<>::messageOverhead, robot, 0);
+	CHECK_EQ(used, ReliableLane<>::overhead + ReliableLane<>::messageOverhead);
+	CHECK_EQ(packet[used], 0xEE);
+	CHECK_EQ(other.detach(packet, used, controller, 0), used);
+	CHECK(other.available());
+}
+
+int main(int argc, char ** argv) {
+	benchRequested(argc, argv);
+	srand(40);
+	deliveredOnce();
+	rebootedSender();
+	roomRespected();
+	return TEST_RESULT();
+}
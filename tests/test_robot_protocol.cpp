@@ -0,0 +1,219 @@
+/*
+* RobotProtocol: every schema survives encode -> frame -> decode, quantized
+* fields come back within one step, and the handler table routes by type.
+* --bench prints ns per encode + decode of a control packet and a telemetry page.
+*/
+
+#include "test.h"
+#include "DataPacker2.h"
+#include "RobotProtocol.h"
+
+typedef DataPacker2<UART_PACKET_SIZE> Packet;
+
+static int randomIn(const int lo, const int hi) {
+	return lo + rand() % (hi - lo + 1);
+}
+
+static bool sameFlags(const TelemetryMessage & a, const TelemetryMessage & b) {
+	return a.from == b.from && a.to == b.to && a.page == b.page && a.emergency == b.emergency
+		&& a.enable == b.enable && a.relay_1 == b.relay_1 && a.relay_2 == b.relay_2;
+}
+
+/// goes through a variable-length frame, as on air
+static bool overAir(const Packet & tx, Packet & rx) {
+	// writeFrame() never exceeds maxFrameSize(), but gcc cannot see the length bound
+	uint8_t frame[255 + 3];
+	const uint8_t size = tx.writeFrame(frame);
+	return rx.readFrame(frame, size);
+}
+
+static void controlRoundTrip() {
+	for (uint16_t round = 0; round < 2000; ++round) {
+		ControlMessage sent;
+		sent.from = rand() & 0x0F;
+		sent.to = rand() & 0x0F;
+		sent.emergency = rand() & 1;
+		sent.enable = rand() & 1;
+		sent.relay_1 = rand() & 1;
+		sent.relay_2 = rand() & 1;
+		sent.joystick_x = randomIn(-100, 100);
+		sent.joystick_y = randomIn(-100, 100);
+		sent.max_v_percent = randomIn(0, 100);
+
+		Packet tx, rx;
+		ControlSchema::encode(sent, tx);
+		CHECK_EQ(tx.length(), ControlSchema::size);
+		CHECK(overAir(tx, rx));
+		CHECK_EQ(LinkField::type(rx), uint8_t(MessageType::CONTROL));
+		CHECK_EQ(LinkField::from(rx.getBuffer()[0]), sent.from);
+		CHECK_EQ(LinkField::to(rx.getBuffer()[0]), sent.to);
+
+		ControlMessage received;
+		ControlSchema::decode(rx, received);
+		CHECK_EQ(received.from, sent.from);
+		CHECK_EQ(received.to, sent.to);
+		CHECK_EQ(received.emergency, sent.emergency);
+		CHECK_EQ(received.enable, sent.enable);
+		CHECK_EQ(received.relay_1, sent.relay_1);
+		CHECK_EQ(received.relay_2, sent.relay_2);
+		// 8 bits over 200: one step is 0.78, rounding keeps the error below 1
+		CHECK(abs(received.joystick_x - sent.joystick_x) <= 1);
+		CHECK(abs(received.joystick_y - sent.joystick_y) <= 1);
+		CHECK(abs(received.max_v_percent - sent.max_v_percent) <= 1);
+	}
+
+	// ends of the range are exact, out of range values are clamped
+	ControlMessage sent, received;
+	sent.joystick_x = -100;
+	sent.joystick_y = 250;
+	sent.max_v_percent = -5;
+	Packet packet;
+	ControlSchema::encode(sent, packet);
+	ControlSchema::decode(packet, received);
+	CHECK_EQ(received.joystick_x, -100);
+	CHECK_EQ(received.joystick_y, 100);
+	CHECK_EQ(received.max_v_percent, 0);
+}
+
+static void telemetryRoundTrip() {
+	for (uint16_t round = 0; round < 2000; ++round) {
+		TelemetryMessage sent;
+		sent.from = rand() & 0x0F;
+		sent.to = rand() & 0x0F;
+		sent.page = telemetry_rotation[round % (sizeof(telemetry_rotation) / sizeof(telemetry_rotation[0]))];
+		sent.emergency = rand() & 1;
+		sent.enable = rand() & 1;
+		sent.relay_1 = rand() & 1;
+		sent.relay_2 = rand() & 1;
+		sent.left_percent = randomIn(-100, 100);
+		sent.right_percent = randomIn(-100, 100);
+		sent.left_steps = randomIn(-(1 << 23), (1 << 23) - 1);
+		sent.right_steps = randomIn(-(1 << 23), (1 << 23) - 1);
+		sent.loop_max_us = rand();
+		sent.isr_load_percent = randomIn(0, 100);
+		sent.supply_mv = randomIn(0, 25500);
+		sent.loss_percent = randomIn(0, 100);
+		sent.error_percent = randomIn(0, 100);
+		sent.rtt_ms = randomIn(0, 1023);
+		sent.jitter_ms = rand();
+
+		Packet tx, rx;
+		encodeTelemetry(sent, tx);
+		CHECK_EQ(tx.length(), telemetrySize(sent.page));
+		CHECK(tx.length() <= TelemetrySteps::size);
+		CHECK(overAir(tx, rx));
+
+		TelemetryPage page;
+		CHECK(telemetryPage(LinkField::type(rx), page));
+		CHECK(page == sent.page);
+
+		TelemetryMessage received;
+		decodeTelemetry(rx, received);
+		CHECK(sameFlags(received, sent));
+		switch (sent.page) {
+		case TelemetryPage::VELOCITY:
+			CHECK(abs(received.left_percent - sent.left_percent) <= 1);
+			CHECK(abs(received.right_percent - sent.right_percent) <= 1);
+			break;
+		case TelemetryPage::STEPS:
+			// low 24 bits on air
+			CHECK_EQ(received.left_steps & 0xFFFFFF, sent.left_steps & 0xFFFFFF);
+			CHECK_EQ(received.right_steps & 0xFFFFFF, sent.right_steps & 0xFFFFFF);
+			break;
+		case TelemetryPage::HEALTH:
+			CHECK_EQ(received.loop_max_us, sent.loop_max_us);
+			CHECK_EQ(received.isr_load_percent, sent.isr_load_percent);
+			// 100 mV steps
+			CHECK(abs(received.supply_mv - sent.supply_mv) <= 50);
+			break;
+		case TelemetryPage::LINK:
+			CHECK_EQ(received.loss_percent, sent.loss_percent);
+			CHECK_EQ(received.error_percent, sent.error_percent);
+			CHECK_EQ(received.rtt_ms, sent.rtt_ms);
+			CHECK_EQ(received.jitter_ms, sent.jitter_ms);
+			break;
+		}
+	}
+
+	CHECK_EQ(TelemetryHeader::size, 2);
+	TelemetryPage page;
+	CHECK(!telemetryPage(uint8_t(MessageType::CONTROL), page));
+	CHECK(!telemetryPage(uint8_t(MessageType::TELEMETRY) + 4, page));
+}
+
+static int controls_seen = 0;
+static int telemetry_seen = 0;
+static TelemetryPage last_page;
+
+static void onControl(const ControlMessage &) {
+	controls_seen++;
+}
+
+static void onTelemetry(const TelemetryMessage & message) {
+	telemetry_seen++;
+	last_page = message.page;
+}
+
+typedef MessageTable<
+	MessageHandler<MessageType::CONTROL, ControlSchema, ControlMessage, onControl>,
+	TelemetryHandler<onTelemetry>
+> HostMessages;
+
+static void dispatch() {
+	Packet packet;
+	ControlSchema::encode(ControlMessage(), packet);
+	CHECK(HostMessages::dispatch(LinkField::type(packet), packet));
+	CHECK_EQ(controls_seen, 1);
+	CHECK_EQ(telemetry_seen, 0);
+
+	TelemetryMessage health;
+	health.page = TelemetryPage::HEALTH;
+	encodeTelemetry(health, packet);
+	CHECK(HostMessages::dispatch(LinkField::type(packet), packet));
+	CHECK_EQ(telemetry_seen, 1);
+	CHECK(last_page == TelemetryPage::HEALTH);
+
+	// truncated packets and unknown types are refused
+	packet.setLength(TelemetryHealth::size - 1);
+	CHECK(!HostMessages::dispatch(LinkField::type(packet), packet));
+	CHECK(!HostMessages::dispatch(9, packet));
+	ControlSchema::encode(ControlMessage(), packet);
+	packet.setLength(ControlSchema::size - 1);
+	CHECK(!HostMessages::dispatch(LinkField::type(packet), packet));
+	CHECK_EQ(controls_seen, 1);
+	CHECK_EQ(telemetry_seen, 1);
+}
+
+int main(int argc, char ** argv) {
+	srand(30);
+	controlRoundTrip();
+	telemetryRoundTrip();
+	dispatch();
+
+	if (benchRequested(argc, argv)) {
+		Packet packet;
+		ControlMessage command;
+		command.joystick_x = 37;
+		command.joystick_y = -58;
+		command.max_v_percent = 80;
+		const double control_ns = BENCH_NS(1000000, {
+			command.joystick_x = _round & 0x3F;
+			ControlSchema::encode(command, packet);
+			ControlMessage decoded;
+			ControlSchema::decode(packet, decoded);
+			benchKeep(decoded);
+		});
+		TelemetryMessage telemetry;
+		telemetry.page = TelemetryPage::STEPS;
+		const double telemetry_ns = BENCH_NS(1000000, {
+			telemetry.left_steps = _round;
+			encodeTelemetry(telemetry, packet);
+			TelemetryMessage decoded;
+			decodeTelemetry(packet, decoded);
+			benchKeep(decoded);
+		});
+		printf("control packet: %.1f ns, steps page: %.1f ns per encode + decode on this host\n",
+			control_ns, telemetry_ns);
+	}
+	return TEST_RESULT();
+}
@@ -0,0 +1,128 @@
+/*
+* SetpointBuffer: a late packet holds the newest setpoint instead of
+* extrapolating, ramps stay between their two setpoints, and a replayed
+* jittery, lossy, reordered stream never leaves the commanded range.
+*/
+
+#include "test.h"
+#include "SetpointBuffer.h"
+
+static const float max_v = 20000.0f;
+
+/// 'buffer' played from 'from_ms' to 'to_ms', every sample present and within [lo, hi]
+static bool playsWithin(SetpointBuffer<> & buffer, const uint32_t from_ms, const uint32_t to_ms,
+	const float lo, const float hi) {
+	bool within = true;
+	for (uint32_t now = from_ms; now < to_ms; ++now) {
+		float left = 0, right = 0;
+		const bool sampled = buffer.sample(now, left, right);
+		within = within && sampled && left >= lo && left <= hi && right >= -hi && right <= -lo;
+	}
+	return within;
+}
+
+static void lateHolds() {
+	// 0 -> full speed, then the link goes quiet: no overshoot past full speed
+	SetpointBuffer<> buffer;
+	float left = 1, right = 1;
+	CHECK(!buffer.sample(0, left, right));
+	buffer.push(1000, 0, 0, 1020);
+	buffer.push(1050, max_v, -max_v, 1070);
+	CHECK(playsWithin(buffer, 1070, 3000, 0, max_v));
+	CHECK(buffer.sample(3000, left, right));
+	CHECK(left == max_v && right == -max_v);
+
+	// slowing down and then late: never below the slower setpoint, never reversed
+	buffer.push(3000, max_v / 5, -max_v / 5, 3020);
+	CHECK(playsWithin(buffer, 3020, 5000, max_v / 5, max_v));
+	CHECK(buffer.sample(5000, left, right));
+	CHECK(left == max_v / 5 && right == -max_v / 5);
+
+	// a stop is exact and stays a stop
+	buffer.push(5000, 0, 0, 5020);
+	CHECK(playsWithin(buffer, 5020, 7000, 0, max_v / 5));
+	CHECK(buffer.sample(7000, left, right));
+	CHECK(left == 0 && right == 0);
+}
+
+static void rampIsMonotonic() {
+	SetpointBuffer<> buffer;
+	buffer.push(0, 0, 0, 10);
+	buffer.push(50, 1000, -1000, 60);
+	float previous = 0;
+	bool monotonic = true;
+	for (uint32_t now = 60; now < 400; ++now) {
+		float left = 0, right = 0;
+		const bool sampled = buffer.sample(now, left, right);
+		monotonic = monotonic && sampled && left >= previous && left <= 1000 && right == -left;
+		previous = left;
+	}
+	CHECK(monotonic);
+	CHECK(previous == 1000);
+}
+
+/// setpoints every 50 ms, 20% lost, delivered 20..150 ms late (so some out of order)
+static void replay() {
+	struct Packet {
+		uint32_t sent_ms;
+		uint32_t arrival_ms;
+		float left;
+	};
+	const uint16_t count = 2000;
+	static Packet packets[count];
+	srand(36);
+	for (uint16_t i = 0; i < count; ++i) {
+		packets[i].sent_ms = 1000 + 50 * i;
+		packets[i].arrival_ms = packets[i].sent_ms + 20 + rand() % 131;
+		// mostly small moves, sometimes a full-speed reversal
+		const float previous = i > 0 ? packets[i - 1].left : 0;
+		float left = rand() % 8 == 0 ? (rand() % 2 ? max_v : -max_v) : previous + (rand() % 2001 - 1000);
+		if (left > max_v)
+			left = max_v;
+		if (left < -max_v)
+			left = -max_v;
+		packets[i].left = left;
+	}
+
+	SetpointBuffer<> buffer;
+	bool in_range = true;
+	bool bounded_by_recent = true;
+	uint32_t delivered = 0;
+	const uint32_t end_ms = packets[count - 1].arrival_ms + 1000;
+	for (uint32_t now = 1000; now < end_ms; ++now) {
+		// packets sent in the last second, the only ones arriving now
+		const uint16_t first = now > 2000 ? (now - 2000) / 50 : 0;
+		const uint16_t last = (now - 1000) / 50 + 1 < count ? (now - 1000) / 50 + 1 : count;
+		for (uint16_t i = first; i < last; ++i)
+			if (packets[i].arrival_ms == now && rand() % 5 != 0) {
+				buffer.push(packets[i].sent_ms, packets[i].left, -packets[i].left, now);
+				delivered++;
+			}
+
+		float left, right;
+		if (!buffer.sample(now, left, right))
+			continue;
+		in_range = in_range && left >= -max_v && left <= max_v && right == -left;
+
+		// the output sits between setpoints sent within the last second
+		float lo = max_v, hi = -max_v;
+		for (uint16_t i = first; i < last; ++i)
+			if (packets[i].sent_ms + 1000 >= now && packets[i].sent_ms <= now) {
+				lo = packets[i].left < lo ? packets[i].left : lo;
+				hi = packets[i].left > hi ? packets[i].left : hi;
+			}
+		if (lo <= hi)
+			bounded_by_recent = bounded_by_recent && left >= lo && left <= hi;
+	}
+	CHECK(delivered > count * 3 / 4 - 50);
+	CHECK(in_range);
+	CHECK(bounded_by_recent);
+}
+
+int main(int argc, char ** argv) {
+	benchRequested(argc, argv);
+	lateHolds();
+	rampIsMonotonic();
+	replay();
+	return TEST_RESULT();
+}
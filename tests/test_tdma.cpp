@@ -0,0 +1,180 @@
+/*
+* One Controller polling 10 robots (one of them switched off) through
+* PollSchedule on a simulated E32 channel at 2.4k, slots sized like
+* AsyncUart::turnUs() with the worst-case reliable lane message.
+* Prints per-robot command latency (time between polls) and aggregate throughput,
+* checks that no robot goes longer without a command than the link timeout
+* (pollTimeoutMs(), what AsyncUart::linkTimeoutMs() uses with TDMA_ROBOTS = 10),
+* and checks LinkStats kept per peer: with a single LinkStats shared by all
+* robots each robot sees the Controller's sequence jump by N and reports loss.
+*/
+
+#include "test.h"
+#include "RobotProtocol.h"
+#include "LinkStats.h"
+#include "ReliableLane.h"
+#include "PollSchedule.h"
+#include "sim_air.h"
+
+// AsyncUart defaults
+static const uint32_t air_rate = 2400;
+static const uint32_t module_baud = 9600;
+static const uint32_t reply_window_us = 20000;
+static const uint32_t guard_us = 10000;
+
+static const uint8_t link_overhead = LinkStats::headerSize + ReliableLane<>::overhead;
+static const uint8_t command_bytes = ControlSchema::size + link_overhead + 3;
+static const uint8_t reply_bytes = TelemetrySteps::size + link_overhead + 3;
+// a reliable lane message may ride on either packet
+static const uint8_t worst_command_bytes = command_bytes + ReliableLane<>::messageOverhead;
+static const uint8_t worst_reply_bytes = reply_bytes + ReliableLane<>::messageOverhead;
+
+static const uint8_t robot_count = 10;
+static const uint8_t first_robot = controller_id + 1;
+static const uint8_t silent_robot = first_robot + 6;
+static const uint32_t step_us = 100;
+static const uint32_t run_us = 300000000UL;
+
+struct Robot {
+	LinkStats stats;
+	bool reply_pending;
+	uint32_t reply_due_us;
+	uint32_t commands;
+	uint32_t last_command_us;
+	uint32_t max_gap_us;        // longest time without a command, what the Receiver's timeout sees
+};
+
+struct Result {
+	uint32_t collided;
+	uint32_t replies;
+	uint32_t reply_bytes;
+	uint8_t robot_loss_percent[16];
+	uint16_t rtt_ms[16];        // Controller's view after the last reply, the window is shorter than a cycle
+	uint32_t max_gap_us[16];
+};
+
+/// module latency on top of the UART, up to half the guard
+static uint32_t latencyUs() {
+	return rand() % (guard_us / 2);
+}
+
+static Result simulate(const bool stats_per_peer, PollSchedule<> & poll, LinkStats * controller_stats) {
+	SimAir air(air_rate, module_baud);
+	static Robot robots[16];
+	for (uint8_t i = 0; i < 16; ++i)
+		robots[i] = Robot();
+	LinkStats shared;
+
+	const uint32_t slot_us = turnAirtimeUs(worst_command_bytes, worst_reply_bytes, air_rate, module_baud,
+		reply_window_us, guard_us);
+	for (uint8_t i = 0; i < robot_count; ++i)
+		poll.add(first_robot + i, slot_us);
+
+	Result result = {};
+	uint8_t header[LinkStats::headerSize];
+	for (uint32_t now = 0; now < run_us; now += step_us) {
+		AirPacket packet;
+		while (air.receive(now, packet)) {
+			if (packet.lost)
+				continue;
+			if (packet.to == controller_id) {
+				controller_stats[packet.from].receive(packet.data, now / 1000);
+				result.rtt_ms[packet.from] = controller_stats[packet.from].quality(now / 1000).rtt_ms;
+				poll.replied(packet.from);
+				result.replies++;
+				result.reply_bytes += TelemetrySteps::size;
+			}
+			else if (packet.to != silent_robot) {
+				Robot & robot = robots[packet.to];
+				robot.stats.receive(packet.data, now / 1000);
+				if (robot.commands > 0 && now - robot.last_command_us > robot.max_gap_us)
+					robot.max_gap_us = now - robot.last_command_us;
+				robot.last_command_us = now;
+				robot.commands++;
+				// answered from the robot's loop, inside the reply window
+				robot.reply_due_us = now + 500 + rand() % (reply_window_us / 2);
+				robot.reply_pending = true;
+			}
+		}
+
+		// Controller
+		const PollSchedule<>::Slot * slot = poll.due(now);
+		if (slot != nullptr) {
+			LinkStats & stats = stats_per_peer ? controller_stats[slot->address] : shared;
+			stats.stamp(header, now / 1000);
+			air.send(controller_id, slot->address, command_bytes, now, latencyUs(), header, sizeof(header));
+			poll.polled(now);
+		}
+
+		// robots
+		for (uint8_t address = first_robot; address < first_robot + robot_count; ++address) {
+			Robot & robot = robots[address];
+			if (robot.reply_pending && now >= robot.reply_due_us) {
+				robot.stats.stamp(header, now / 1000);
+				air.send(address, controller_id, reply_bytes, now, latencyUs(), header, sizeof(header));
+				robot.reply_pending = false;
+			}
+		}
+	}
+
+	result.collided = air.collided();
+	for (uint8_t address = first_robot; address < first_robot + robot_count; ++address) {
+		result.robot_loss_percent[address] = robots[address].stats.quality(run_us / 1000).loss_percent;
+		result.max_gap_us[address] = robots[address].max_gap_us;
+	}
+	return result;
+}
+
+int main(int argc, char ** argv) {
+	benchRequested(argc, argv);
+	srand(39);
+
+	static LinkStats controller_stats[16];
+	PollSchedule<> poll;
+	const Result result = simulate(true, poll, controller_stats);
+
+	const uint32_t seconds = run_us / 1000000UL;
+	const uint32_t timeout_ms = pollTimeoutMs(robot_count, poll.slot(0).length_us, LINK_TIMEOUT_MS);
+	printf("%u robots at %lu bps, slot %lu ms, worst cycle %lu ms, link timeout %lu ms, %u collisions\n",
+		robot_count, (unsigned long)air_rate, (unsigned long)(poll.slot(0).length_us / 1000),
+		(unsigned long)(poll.cycleUs() / 1000), (unsigned long)timeout_ms, result.collided);
+	// the fixed timeout the Receiver used before: every robot would cut out
+	CHECK(poll.cycleUs() / 1000 >= LINK_TIMEOUT_MS);
+	CHECK(poll.cycleUs() / 1000 < timeout_ms);
+	printf("robot  polls  replies  latency ms  max gap ms  rtt ms  loss %%\n");
+	bool bounded = true;
+	for (uint8_t i = 0; i < poll.count(); ++i) {
+		const PollSchedule<>::Slot & slot = poll.slot(i);
+		const LinkQuality q = controller_stats[slot.address].quality(run_us / 1000);
+		printf("%5u  %5u  %7u  %10lu  %10lu  %6u  %6u\n", slot.address, slot.polls, slot.replies,
+			(unsigned long)(slot.interval_us / 1000), (unsigned long)(result.max_gap_us[slot.address] / 1000),
+			result.rtt_ms[slot.address], result.robot_loss_percent[slot.address]);
+		bounded = bounded && slot.interval_us <= poll.cycleUs();
+		// no robot, silent or not, is polled too rarely to keep its link up
+		CHECK(slot.interval_us < timeout_ms * 1000UL);
+		if (slot.address == silent_robot) {
+			CHECK_EQ(slot.replies, 0);
+			continue;
+		}
+		// every poll answered, both ends see a clean link with a real round trip
+		CHECK(slot.replies + 1 >= slot.polls);
+		CHECK_EQ(result.robot_loss_percent[slot.address], 0);
+		CHECK_EQ(q.loss_percent, 0);
+		CHECK(result.max_gap_us[slot.address] > 0 && result.max_gap_us[slot.address] < timeout_ms * 1000UL);
+		CHECK(result.rtt_ms[slot.address] > 0 && result.rtt_ms[slot.address] < slot.length_us / 1000);
+	}
+	printf("throughput: %.2f replies/s, %.1f telemetry bytes/s\n",
+		float(result.replies) / seconds, float(result.reply_bytes) / seconds);
+	CHECK_EQ(result.collided, 0);
+	CHECK(bounded);
+	// the silent robot costs its whole slot, everyone else only what they use
+	CHECK(poll.slot(0).polls > seconds * 1000000UL / poll.cycleUs());
+
+	// one LinkStats for all robots: every robot sees N - 1 of N sequence numbers missing
+	static LinkStats shared_controller_stats[16];
+	PollSchedule<> shared_poll;
+	const Result shared = simulate(false, shared_poll, shared_controller_stats);
+	printf("shared LinkStats: robot %u reports %u%% loss\n", first_robot, shared.robot_loss_percent[first_robot]);
+	CHECK(shared.robot_loss_percent[first_robot] > 80);
+	return TEST_RESULT();
+}
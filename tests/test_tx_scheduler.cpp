@@ -0,0 +1,224 @@
+/*
+* TxScheduler: deadband, rate cap, heartbeat, immediate send and burst on a
+* safety edge, and a refused write leaving the command due. Then a synthetic
+* one minute stick trace (holds, slow and fast moves, ADC noise, switch edges)
+* replayed through due() / sent() and through the fixed DO_EVERY(100) sender
+* it replaced, printing mean latency and bytes / time on air of both.
+* Latency: how long the robot's last command stays off the input by more than
+* the deadband (or misses a switch), from the moment it does until a packet goes out.
+*/
+
+#include "test.h"
+#include "Arduino.h"
+#include "TxScheduler.h"
+#include "Airtime.h"
+
+// AsyncUart's default and the rate E32_NEGOTIATE moves to
+static const uint32_t air_rate = 2400;
+static const uint32_t fast_air_rate = 9600;
+
+static void deadband() {
+	TxScheduler scheduler;
+	ControlMessage command;
+	CHECK(scheduler.due(command, 0));
+	scheduler.sent(command, 0);
+	// through the burst of the first packet
+	for (uint32_t now = TX_MIN_INTERVAL_MS; now < TX_BURST_COUNT * TX_MIN_INTERVAL_MS; now += TX_MIN_INTERVAL_MS)
+		scheduler.sent(command, now);
+
+	const uint32_t now = TX_BURST_COUNT * TX_MIN_INTERVAL_MS;
+	command.joystick_x = TX_DEADBAND;
+	CHECK(!scheduler.due(command, now));
+	command.joystick_x = TX_DEADBAND + 1;
+	CHECK(scheduler.due(command, now));
+	scheduler.sent(command, now);
+
+	// back to exactly 0 is always a change
+	command.joystick_x = 1;
+	CHECK(!scheduler.due(command, now + TX_MIN_INTERVAL_MS));
+	scheduler.sent(command, now + TX_MIN_INTERVAL_MS);
+	command.joystick_x = 0;
+	CHECK(scheduler.due(command, now + 2 * TX_MIN_INTERVAL_MS));
+}
+
+static void rateCapAndHeartbeat() {
+	TxScheduler scheduler;
+	ControlMessage command;
+	uint32_t now = 0;
+	for (uint8_t i = 0; i < TX_BURST_COUNT; ++i, now += TX_MIN_INTERVAL_MS)
+		scheduler.sent(command, now);
+	const uint32_t last = now - TX_MIN_INTERVAL_MS;
+
+	// a big move right after a packet waits for the rate cap
+	command.joystick_y = 80;
+	CHECK(!scheduler.due(command, last + 1));
+	CHECK(!scheduler.due(command, last + TX_MIN_INTERVAL_MS - 1));
+	CHECK(scheduler.due(command, last + TX_MIN_INTERVAL_MS));
+	// a refused write() commits nothing: still due
+	CHECK(scheduler.due(command, last + TX_MIN_INTERVAL_MS + 1));
+	scheduler.sent(command, last + TX_MIN_INTERVAL_MS);
+
+	// nothing changes: only the heartbeat
+	const uint32_t sent_ms = last + TX_MIN_INTERVAL_MS;
+	CHECK(!scheduler.due(command, sent_ms + TX_MIN_INTERVAL_MS));
+	CHECK(!scheduler.due(command, sent_ms + TX_HEARTBEAT_MS - 1));
+	CHECK(scheduler.due(command, sent_ms + TX_HEARTBEAT_MS));
+}
+
+static void safetyEdge() {
+	TxScheduler scheduler;
+	ControlMessage command;
+	uint32_t now = 0;
+	for (uint8_t i = 0; i < TX_BURST_COUNT; ++i, now += TX_MIN_INTERVAL_MS)
+		scheduler.sent(command, now);
+	const uint32_t last = now - TX_MIN_INTERVAL_MS;
+
+	// emergency released 1 ms after a packet: sent now, past the rate cap
+	command.emergency = false;
+	CHECK(scheduler.due(command, last + 1));
+	scheduler.sent(command, last + 1);
+	// then repeated TX_BURST_COUNT - 1 times at the rate cap, in case one is lost
+	uint32_t t = last + 1;
+	for (uint8_t i = 1; i < TX_BURST_COUNT; ++i) {
+		CHECK(!scheduler.due(command, t + TX_MIN_INTERVAL_MS - 1));
+		t += TX_MIN_INTERVAL_MS;
+		CHECK(scheduler.due(command, t));
+		scheduler.sent(command, t);
+	}
+	CHECK(!scheduler.due(command, t + TX_MIN_INTERVAL_MS));
+	CHECK_EQ(scheduler.sentCount(), TX_BURST_COUNT + TX_BURST_COUNT);
+
+	// every switch is a safety edge
+	command.relay_2 = true;
+	CHECK(scheduler.due(command, t + 1));
+}
+
+/// the stick and switches as loop() reads them, one sample per ms
+struct Trace {
+	ControlMessage at(const uint32_t ms) const {
+		ControlMessage command;
+		const uint32_t phase = ms % 20000;
+		command.emergency = ms < 2000 || (ms > 45000 && ms < 46000);
+		command.enable = ms > 3000;
+		command.relay_1 = (ms / 15000) % 2 == 1;
+		command.max_v_percent = 60;
+		int16_t x = 0, y = 0;
+		if (phase < 4000)
+			y = 0;                                  // hold at rest
+		else if (phase < 8000)
+			y = (phase - 4000) * 100 / 4000;        // slow push to full
+		else if (phase < 12000)
+			y = 100;                                // hold at full
+		else if (phase < 12300)
+			y = 100 - (phase - 12000) / 3;          // fast release
+		else if (phase < 16000)
+			x = (phase / 500) % 2 ? 70 : -70;       // quick turns
+		// ADC noise of one percent around a deflected stick, the joystick deadzone reads 0 at rest
+		command.joystick_x = x == 0 ? 0 : x + int16_t(noise(ms) % 3) - 1;
+		command.joystick_y = y == 0 ? 0 : y + int16_t(noise(ms + 7) % 3) - 1;
+		return command;
+	}
+
+	static uint32_t noise(const uint32_t ms) {
+		uint32_t h = ms * 2654435761UL;
+		return h >> 24;
+	}
+};
+
+static bool axisOff(const int16_t input, const int16_t robot) {
+	return input == 0 ? robot != 0 : abs(input - robot) > TX_DEADBAND;
+}
+
+/// the robot's command no longer matches the input
+static bool stale(const ControlMessage & input, const ControlMessage & robot) {
+	return input.emergency != robot.emergency || input.enable != robot.enable
+		|| input.relay_1 != robot.relay_1 || input.relay_2 != robot.relay_2
+		|| axisOff(input.joystick_x, robot.joystick_x) || axisOff(input.joystick_y, robot.joystick_y)
+		|| axisOff(input.max_v_percent, robot.max_v_percent);
+}
+
+struct Replay {
+	uint32_t packets;
+	uint32_t changes;
+	uint64_t latency_sum_ms;
+	uint32_t latency_max_ms;
+	uint32_t longest_gap_ms;
+	uint32_t under_cap;         // packets closer than the rate cap without a safety edge
+};
+
+static Replay replay(const bool scheduled, const uint32_t duration_ms) {
+	const Trace trace;
+	TxScheduler scheduler;
+	Replay r = { 0, 0, 0, 0, 0, 0 };
+	ControlMessage last_sent;
+	bool waiting = false;
+	uint32_t change_ms = 0, last_tx_ms = 0;
+	for (uint32_t now = 0; now < duration_ms; ++now) {
+		const ControlMessage command = trace.at(now);
+		if (!waiting && r.packets > 0 && stale(command, last_sent)) {
+			waiting = true;
+			change_ms = now;
+			r.changes++;
+		}
+
+		const bool send = scheduled ? scheduler.due(command, now) : now % 100 == 0;
+		if (!send)
+			continue;
+		if (scheduled)
+			scheduler.sent(command, now);
+		if (r.packets > 0) {
+			r.longest_gap_ms = now - last_tx_ms > r.longest_gap_ms ? now - last_tx_ms : r.longest_gap_ms;
+			const bool edge = command.emergency != last_sent.emergency || command.enable != last_sent.enable
+				|| command.relay_1 != last_sent.relay_1 || command.relay_2 != last_sent.relay_2;
+			if (now - last_tx_ms < TX_MIN_INTERVAL_MS && !edge)
+				r.under_cap++;
+		}
+		last_sent = command;
+		last_tx_ms = now;
+		r.packets++;
+		if (waiting) {
+			r.latency_sum_ms += now - change_ms;
+			r.latency_max_ms = now - change_ms > r.latency_max_ms ? now - change_ms : r.latency_max_ms;
+			waiting = false;
+		}
+	}
+	return r;
+}
+
+static inline double meanLatency(const Replay & r) {
+	return r.changes ? double(r.latency_sum_ms) / r.changes : 0.0;
+}
+
+static void print(const char * name, const Replay & r, const uint32_t duration_ms) {
+	const uint8_t bytes = frameSize(ControlSchema::size);
+	const uint32_t air_ms = r.packets * (e32AirtimeUs(bytes, air_rate) / 1000);
+	const uint32_t fast_air_ms = r.packets * (e32AirtimeUs(bytes, fast_air_rate) / 1000);
+	printf("%-10s %4lu packets %6lu bytes, on air %6lu ms (%5.1f%%) at %lu bps, %5lu ms (%4.1f%%) at %lu bps, "
+		"latency mean %5.1f ms max %3lu ms over %lu changes\n",
+		name, (unsigned long)r.packets, (unsigned long)(r.packets * bytes),
+		(unsigned long)air_ms, 100.0f * air_ms / duration_ms, (unsigned long)air_rate,
+		(unsigned long)fast_air_ms, 100.0f * fast_air_ms / duration_ms, (unsigned long)fast_air_rate,
+		meanLatency(r), (unsigned long)r.latency_max_ms, (unsigned long)r.changes);
+}
+
+int main(int argc, char ** argv) {
+	benchRequested(argc, argv);
+	deadband();
+	rateCapAndHeartbeat();
+	safetyEdge();
+
+	const uint32_t duration_ms = 60000;
+	const Replay scheduled = replay(true, duration_ms);
+	const Replay fixed = replay(false, duration_ms);
+	printf("60 s stick trace, %u byte frames:\n", frameSize(ControlSchema::size));
+	print("scheduled", scheduled, duration_ms);
+	print("every 100", fixed, duration_ms);
+
+	CHECK(scheduled.packets < fixed.packets);
+	CHECK(meanLatency(scheduled) < meanLatency(fixed));
+	// never silent longer than the heartbeat, never faster than the cap (safety edges aside)
+	CHECK(scheduled.longest_gap_ms <= TX_HEARTBEAT_MS);
+	CHECK_EQ(scheduled.under_cap, 0);
+	CHECK(scheduled.latency_max_ms <= TX_MIN_INTERVAL_MS);
+	return TEST_RESULT();
+}